@@ -0,0 +1,95 @@
+// Per-system cost of World iteration at 1M entities, against the same loops over plain arrays.
+// Usage: bench_ecs [entity count, default 1000000]
+
+#include "engine/ecs.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <glm/glm.hpp>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Best of a few runs, after one warm up run
+template <typename F> static double best(F&& run) {
+    run();
+    double result = 1e30;
+    for (int i = 0; i < 10; i++) {
+        auto start = Clock::now();
+        run();
+        result = std::min(result, millisecondsSince(start));
+    }
+    return result;
+}
+
+struct Position {
+    glm::vec3 value;
+};
+
+struct Velocity {
+    glm::vec3 value;
+};
+
+struct Health {
+    float value;
+};
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+    // Every entity moves, every fourth one also has health
+    Engine::World world;
+    for (size_t i = 0; i < count; i++) {
+        auto entity = world.create();
+        world.add(entity, Position{glm::vec3(float(i))});
+        world.add(entity, Velocity{glm::vec3(1.f)});
+        if (i % 4 == 0) {
+            world.add(entity, Health{100.f});
+        }
+    }
+
+    std::vector<glm::vec3> positions(count, glm::vec3(1.f)), velocities(count, glm::vec3(1.f));
+    std::vector<float> healths(count / 4 + 1, 100.f);
+    float dt = 0.01f;
+
+    auto integrate = best([&]() {
+        world.each<Position, Velocity>([&](Position& p, Velocity& v) { p.value += v.value * dt; });
+    });
+    auto damp = best([&]() { world.each<Velocity>([&](Velocity& v) { v.value *= 0.99f; }); });
+    auto regenerate = best([&]() { world.each<Health>([&](Health& h) { h.value = std::min(h.value + dt, 100.f); }); });
+
+    auto raw_integrate = best([&]() {
+        for (size_t i = 0; i < count; i++) {
+            positions[i] += velocities[i] * dt;
+        }
+    });
+    auto raw_damp = best([&]() {
+        for (auto& v : velocities) {
+            v *= 0.99f;
+        }
+    });
+    auto raw_regenerate = best([&]() {
+        for (auto& h : healths) {
+            h = std::min(h + dt, 100.f);
+        }
+    });
+
+    world.addSystem<Position, Velocity>([](float dt, Position& p, Velocity& v) { p.value += v.value * dt; });
+    world.addSystem<Velocity>([](float, Velocity& v) { v.value *= 0.99f; });
+    world.addSystem<Health>([](float dt, Health& h) { h.value = std::min(h.value + dt, 100.f); });
+    auto systems = best([&]() { world.runSystems(dt); });
+
+    std::printf("%zu entities\n", count);
+    std::printf("%-28s %10s %10s\n", "system", "world (ms)", "raw (ms)");
+    std::printf("%-28s %10.3f %10.3f\n", "integrate Position+Velocity", integrate, raw_integrate);
+    std::printf("%-28s %10.3f %10.3f\n", "damp Velocity", damp, raw_damp);
+    std::printf("%-28s %10.3f %10.3f\n", "regenerate Health (1/4)", regenerate, raw_regenerate);
+    std::printf("%-28s %10.3f\n", "runSystems, all three", systems);
+
+    // Keeps the raw loops from being optimized away
+    return positions[count / 2].x < 0.f ? 1 : 0;
+}
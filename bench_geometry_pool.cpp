@@ -0,0 +1,92 @@
+// GeometryPool with 10k distinct meshes against the GL stub: time to add, remove and defragment them, and the GL calls
+// a flush of all of them takes, against drawing each mesh on its own.
+// Usage: bench_geometry_pool [mesh count, default 10000]
+
+#include "engine/geometry_pool.hpp"
+#include "engine/shapes.hpp"
+#include "gl_stub.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+using Layout = Engine::VertexLayout<glm::vec3, glm::vec2>;
+
+static double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Boxes of different sizes, every tenth mesh a small sphere, so no two meshes hold the same data
+static Engine::ShapeData makeShape(size_t i) {
+    auto size = 0.5f + 0.001f * float(i);
+    return i % 10 == 0 ? Engine::generateSphere(size, 8, 6) : Engine::generateCuboid(glm::vec3{size, 1.f, 2.f});
+}
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+    installGlStub();
+
+    std::vector<Engine::ShapeData> shapes;
+    for (size_t i = 0; i < count; i++) {
+        shapes.push_back(makeShape(i));
+    }
+    auto add = [&](Engine::GeometryPool& pool, size_t i) {
+        auto& shape = shapes[i];
+        return pool.add(shape.positions.size(), shape.indices, shape.positions.data(), shape.uvs.data());
+    };
+
+    // Starts small, so adding grows the buffers a few times on the way
+    Engine::GeometryPool pool{Layout::formats, Layout::stride, 1 << 12, 1 << 14};
+    std::vector<Engine::GeometryId> ids(count);
+
+    auto start = Clock::now();
+    for (size_t i = 0; i < count; i++) {
+        ids[i] = add(pool, i);
+    }
+    auto add_time = millisecondsSince(start);
+
+    // Every other mesh is removed and added again, into the holes the removal left
+    start = Clock::now();
+    for (size_t i = 0; i < count; i += 2) {
+        pool.remove(ids[i]);
+    }
+    auto remove_time = millisecondsSince(start);
+    start = Clock::now();
+    for (size_t i = 0; i < count; i += 2) {
+        ids[i] = add(pool, i);
+    }
+    auto refill_time = millisecondsSince(start);
+
+    for (size_t i = 1; i < count; i += 4) {
+        pool.remove(ids[i]);
+    }
+    start = Clock::now();
+    pool.defragment();
+    auto defragment_time = millisecondsSince(start);
+    for (size_t i = 1; i < count; i += 4) {
+        ids[i] = add(pool, i);
+    }
+
+    auto& calls = glStubStats();
+    calls = {};
+    start = Clock::now();
+    for (auto id : ids) {
+        pool.queueDraw(id);
+    }
+    pool.flush();
+    auto flush_time = millisecondsSince(start);
+    auto flush_calls = calls;
+
+    auto stats = pool.getStats();
+    std::printf("%zu meshes, %.1f MB of vertices, %.1f MB of indices, %zu relocations\n", pool.size(),
+                stats.vertex_bytes_used / 1048576.0, stats.index_bytes_used / 1048576.0, stats.relocations);
+    std::printf("%-34s %10.2f ms\n", "add all", add_time);
+    std::printf("%-34s %10.2f ms\n", "remove every other", remove_time);
+    std::printf("%-34s %10.2f ms\n", "add them again", refill_time);
+    std::printf("%-34s %10.2f ms\n", "defragment", defragment_time);
+    std::printf("%-34s %10.2f ms\n", "queue and flush all", flush_time);
+    std::printf("GL calls per flush: %zu, of which draws: %zu (one draw per mesh would be %zu)\n", flush_calls.calls,
+                flush_calls.draw_calls, pool.size());
+    return flush_calls.draw_calls == 1 ? 0 : 1;
+}
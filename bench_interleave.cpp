@@ -0,0 +1,79 @@
+// Interleaving 500k vertices (vec3 position, vec3 normal, vec2 uv) three ways: the per-field loops Mesh falls back to,
+// VertexLayout with one fixed size memcpy per attribute, and VertexLayout::interleave with wide SSE stores, which is
+// what Mesh uses for all-Float layouts.
+// Usage: bench_interleave [vertex count, default 500000]
+
+#include "engine/vertex_format.hpp"
+#include "engine/vertex_layout.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+using Layout = Engine::VertexLayout<glm::vec3, glm::vec3, glm::vec2>;
+
+static double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Best of a few runs, after one warm up run
+template <typename F> static double best(F&& run) {
+    run();
+    double result = 1e30;
+    for (int i = 0; i < 10; i++) {
+        auto start = Clock::now();
+        run();
+        result = std::min(result, millisecondsSince(start));
+    }
+    return result;
+}
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 500000;
+
+    std::vector<glm::vec3> positions(count), normals(count);
+    std::vector<glm::vec2> uvs(count);
+    for (size_t i = 0; i < count; i++) {
+        positions[i] = glm::vec3(float(i), float(i) * 0.5f, -float(i));
+        normals[i] = glm::vec3(0.f, 1.f, float(i % 7));
+        uvs[i] = glm::vec2(float(i % 13), float(i % 17));
+    }
+
+    auto size = count * Layout::stride;
+    std::vector<std::byte> per_field(size), fixed(size), wide(size);
+
+    auto per_field_time = best([&]() {
+        auto out = per_field.data();
+        Engine::interleaveEncodedAttribute(Engine::VertexFormat::Float, out + Layout::offsets[0], Layout::stride,
+                                           positions.data(), count);
+        Engine::interleaveEncodedAttribute(Engine::VertexFormat::Float, out + Layout::offsets[1], Layout::stride,
+                                           normals.data(), count);
+        Engine::interleaveEncodedAttribute(Engine::VertexFormat::Float, out + Layout::offsets[2], Layout::stride,
+                                           uvs.data(), count);
+    });
+
+    auto fixed_time = best([&]() {
+        for (size_t i = 0; i < count; i++) {
+            auto vertex = fixed.data() + i * Layout::stride;
+            std::memcpy(vertex + Layout::offsets[0], &positions[i], sizeof(glm::vec3));
+            std::memcpy(vertex + Layout::offsets[1], &normals[i], sizeof(glm::vec3));
+            std::memcpy(vertex + Layout::offsets[2], &uvs[i], sizeof(glm::vec2));
+        }
+    });
+
+    auto wide_time = best([&]() {
+        Layout::interleave(wide.data(), count, positions.data(), normals.data(), uvs.data());
+    });
+
+    if (per_field != fixed || fixed != wide) {
+        std::printf("interleaved buffers differ\n");
+        return 1;
+    }
+
+    std::printf("%zu vertices of %zu bytes\n", count, Layout::stride);
+    std::printf("%-34s %8.2f ms\n", "per field (Mesh fallback)", per_field_time);
+    std::printf("%-34s %8.2f ms\n", "VertexLayout, memcpy per attribute", fixed_time);
+    std::printf("%-34s %8.2f ms\n", "VertexLayout, wide stores", wide_time);
+}
@@ -0,0 +1,79 @@
+// Scaling of Node::parallelUpdate and of plain fork-join jobs across thread counts.
+// Usage: bench_jobs [max threads, default hardware concurrency]
+
+#include "engine/arch.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using Clock = std::chrono::steady_clock;
+
+static double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Node with a fixed amount of arithmetic in preUpdate, standing in for game logic
+struct Worker : Engine::Node {
+    float state = 1.f;
+
+    void preUpdate(float deltaTime) override {
+        for (int i = 0; i < 200; i++) {
+            state = std::sin(state + deltaTime) * 0.5f + 1.f;
+        }
+    }
+};
+
+// Best of a few runs, after one warm up run
+template <typename F> static double best(F&& run) {
+    run();
+    double result = 1e30;
+    for (int i = 0; i < 5; i++) {
+        auto start = Clock::now();
+        run();
+        result = std::min(result, millisecondsSince(start));
+    }
+    return result;
+}
+
+int main(int argc, char** argv) {
+    size_t max_threads = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : std::thread::hardware_concurrency();
+
+    // 64 subtrees of 256 nodes below the root
+    Engine::Node root;
+    for (int i = 0; i < 64; i++) {
+        auto group = root.emplace<Worker>("group" + std::to_string(i));
+        for (int j = 0; j < 255; j++) {
+            group->emplace<Worker>("worker" + std::to_string(j));
+        }
+    }
+
+    auto serial = best([&]() { root.update(0.01f); });
+    std::printf("Node::update, 16k nodes: %.2f ms\n", serial);
+    std::printf("%8s %14s %8s %18s\n", "threads", "parallel (ms)", "speedup", "fork-join (ms)");
+
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        Engine::JobSystem jobs{threads};
+        auto parallel = best([&]() { root.parallelUpdate(0.01f, jobs); });
+
+        // 4096 jobs of the same size as one Worker::preUpdate, joined on one group
+        std::vector<float> states(4096, 1.f);
+        auto fork_join = best([&]() {
+            auto group = jobs.create(nullptr);
+            for (auto& state : states) {
+                jobs.schedule(
+                    [&state]() {
+                        for (int i = 0; i < 200; i++) {
+                            state = std::sin(state) * 0.5f + 1.f;
+                        }
+                    },
+                    group);
+            }
+            jobs.run(group);
+            jobs.wait(group);
+        });
+
+        std::printf("%8zu %14.2f %7.2fx %18.2f\n", threads, parallel, serial / parallel, fork_join);
+    }
+}
@@ -0,0 +1,44 @@
+// Mesh::generateLods on UV spheres of growing size: time to build four levels, and the triangles of each. LODs are
+// meant to be built at load or build time. The budget is 1 s for the 400-split sphere (320k triangles); the program
+// fails when it is exceeded.
+// Usage: bench_mesh_simplify [largest split count, default 400]
+
+#include "engine/shapes.hpp"
+#include "gl_stub.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+using Clock = std::chrono::steady_clock;
+
+constexpr double BUDGET_MS = 1000.0;
+constexpr size_t BUDGET_SPLITS = 400;
+
+static double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    size_t largest = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : BUDGET_SPLITS;
+    installGlStub();
+
+    bool within_budget = true;
+    std::printf("%-8s %10s  %s\n", "splits", "time (ms)", "triangles per level");
+    for (size_t splits = 50; splits <= largest; splits *= 2) {
+        auto mesh = Engine::sphereMesh(1.f, splits);
+        auto start = Clock::now();
+        auto levels = mesh.generateLods();
+        auto time = millisecondsSince(start);
+
+        std::printf("%-8zu %10.1f ", splits, time);
+        for (size_t lod = 0; lod < levels; lod++) {
+            std::printf(" %zu", mesh.getLodTriangleCount(lod));
+        }
+        std::printf("\n");
+        if (splits == BUDGET_SPLITS && time > BUDGET_MS) {
+            std::printf("over the budget of %.0f ms\n", BUDGET_MS);
+            within_budget = false;
+        }
+    }
+    return within_budget ? 0 : 1;
+}
@@ -0,0 +1,117 @@
+// Spawn/despawn throughput of pooled Node::emplace and Node::remove, against the baseline Node::add, which copied
+// every child into its own make_shared allocation.
+// Usage: bench_pool [wave size, default 5000]
+
+#include "engine/arch.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// The add/remove path of the baseline Node
+struct BaselineNode {
+    virtual ~BaselineNode() = default;
+
+    template <typename T> void add(const std::string& name, T&& child) {
+        auto it = children.find(name);
+        assert(it == children.end() && "Child already exists");
+
+        auto child_ptr = std::make_shared<std::remove_cvref_t<T>>(child);
+        children[name] = child_ptr;
+    }
+
+    void remove(const std::string& name) {
+        auto it = children.find(name);
+        assert(it != children.end() && "Child does not exist");
+
+        children.erase(it);
+    }
+
+    std::map<std::string, std::shared_ptr<BaselineNode>> children;
+};
+
+// Some state of the size of a typical game object
+struct Enemy : Engine::Node {
+    glm::vec3 position{0.f};
+    glm::vec3 velocity{1.f};
+    float health = 100.f;
+    int kind = 0;
+
+    Enemy() = default;
+    explicit Enemy(int kind) : kind{kind} {}
+};
+
+struct BaselineEnemy : BaselineNode {
+    glm::vec3 position{0.f};
+    glm::vec3 velocity{1.f};
+    float health = 100.f;
+    int kind = 0;
+};
+
+constexpr int WAVES = 20;
+
+// Spawns and then despawns WAVES waves, returns the best spawn and despawn times of a single wave
+template <typename Spawn, typename Despawn> static std::pair<double, double> waves(Spawn&& spawn, Despawn&& despawn) {
+    double spawn_time = 1e30, despawn_time = 1e30;
+    for (int i = 0; i < WAVES; i++) {
+        auto start = Clock::now();
+        spawn();
+        spawn_time = std::min(spawn_time, millisecondsSince(start));
+
+        start = Clock::now();
+        despawn();
+        despawn_time = std::min(despawn_time, millisecondsSince(start));
+    }
+    return {spawn_time, despawn_time};
+}
+
+int main(int argc, char** argv) {
+    size_t wave = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 5000;
+
+    std::vector<std::string> names;
+    for (size_t i = 0; i < wave; i++) {
+        names.push_back("enemy" + std::to_string(i));
+    }
+
+    BaselineNode baseline;
+    auto [baseline_spawn, baseline_despawn] = waves(
+        [&]() {
+            for (auto& name : names) {
+                baseline.add(name, BaselineEnemy{});
+            }
+        },
+        [&]() {
+            for (auto& name : names) {
+                baseline.remove(name);
+            }
+        });
+
+    Engine::Node root;
+    auto [pooled_spawn, pooled_despawn] = waves(
+        [&]() {
+            for (auto& name : names) {
+                root.emplace<Enemy>(name, 1);
+            }
+        },
+        [&]() {
+            for (auto& name : names) {
+                root.remove(name);
+            }
+        });
+
+    std::printf("wave of %zu nodes, best of %d waves\n", wave, WAVES);
+    std::printf("%-10s %12s %12s %16s\n", "", "spawn (ms)", "despawn (ms)", "nodes per second");
+    std::printf("%-10s %12.3f %12.3f %16.0f\n", "baseline", baseline_spawn, baseline_despawn,
+                2 * wave / (baseline_spawn + baseline_despawn) * 1000);
+    std::printf("%-10s %12.3f %12.3f %16.0f\n", "pooled", pooled_spawn, pooled_despawn,
+                2 * wave / (pooled_spawn + pooled_despawn) * 1000);
+}
@@ -0,0 +1,112 @@
+// Node::update over the flat depth-first order against the baseline Node, which recursed through a std::map of
+// shared_ptr children, at 1k, 10k and 100k nodes.
+// Usage: bench_scene [node count, default 1000, 10000 and 100000 in turn]
+// Later sizes reuse the pool slots released by earlier ones, pass a single count to measure with fresh pools.
+
+#include "engine/arch.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <string>
+
+using Clock = std::chrono::steady_clock;
+
+static double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Best of a few runs, after one warm up run
+template <typename F> static double best(F&& run) {
+    run();
+    double result = 1e30;
+    for (int i = 0; i < 10; i++) {
+        auto start = Clock::now();
+        run();
+        result = std::min(result, millisecondsSince(start));
+    }
+    return result;
+}
+
+// The update path of the baseline Node
+struct BaselineNode {
+    virtual ~BaselineNode() = default;
+
+    virtual void preUpdate(float) {}
+    virtual void postUpdate(float) {}
+
+    virtual void update(float deltaTime) {
+        preUpdate(deltaTime);
+
+        for (auto& child : children) {
+            child.second->update(deltaTime);
+        }
+
+        postUpdate(deltaTime);
+    }
+
+    std::map<std::string, std::shared_ptr<BaselineNode>> children;
+};
+
+static size_t visited = 0;
+
+struct Counter : Engine::Node {
+    void preUpdate(float) override { visited++; }
+};
+
+struct BaselineCounter : BaselineNode {
+    void preUpdate(float) override { visited++; }
+};
+
+// Breadth-first fill with a fan-out of 8, until count nodes exist
+template <typename Root, typename Add> static void build(Root& root, size_t count, Add&& add) {
+    std::vector<decltype(add(root, std::string{}))> level{add(root, "n")};
+    size_t created = 1;
+    while (created < count) {
+        std::vector<decltype(add(root, std::string{}))> next;
+        for (auto& parent : level) {
+            for (int i = 0; i < 8 && created < count; i++, created++) {
+                next.push_back(add(*parent, "n" + std::to_string(i)));
+            }
+        }
+        level = std::move(next);
+    }
+}
+
+int main(int argc, char** argv) {
+    std::vector<size_t> counts{1000, 10000, 100000};
+    if (argc > 1) {
+        counts = {std::strtoul(argv[1], nullptr, 10)};
+    }
+
+    std::printf("%8s %14s %14s %8s\n", "nodes", "baseline (ms)", "flat (ms)", "speedup");
+
+    for (auto count : counts) {
+        BaselineNode baseline;
+        build(baseline, count, [](BaselineNode& parent, const std::string& name) {
+            auto child = std::make_shared<BaselineCounter>();
+            parent.children[name] = child;
+            return static_cast<BaselineNode*>(child.get());
+        });
+
+        Engine::Node root;
+        build(root, count, [](Engine::Node& parent, const std::string& name) {
+            return parent.emplace<Counter>(name).get();
+        });
+
+        visited = 0;
+        baseline.update(0.01f);
+        auto baseline_visited = visited;
+        visited = 0;
+        root.update(0.01f);
+        if (visited != baseline_visited) {
+            std::printf("visited %zu nodes, baseline %zu\n", visited, baseline_visited);
+            return 1;
+        }
+
+        auto baseline_time = best([&]() { baseline.update(0.01f); });
+        auto flat_time = best([&]() { root.update(0.01f); });
+        std::printf("%8zu %14.3f %14.3f %7.2fx\n", count, baseline_time, flat_time, baseline_time / flat_time);
+    }
+}
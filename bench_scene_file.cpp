@@ -0,0 +1,125 @@
+// Load time of a 100k node scene from the binary scene file, against a naive text format holding the same data.
+// Usage: bench_scene_file [node count, default 100000]
+
+#include "engine/scene_file.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <glm/gtc/matrix_transform.hpp>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Best of a few runs, after one warm up run. setup runs untimed before every run.
+template <typename Setup, typename F> static double best(Setup&& setup, F&& run) {
+    setup();
+    run();
+    double result = 1e30;
+    for (int i = 0; i < 5; i++) {
+        setup();
+        auto start = Clock::now();
+        run();
+        result = std::min(result, millisecondsSince(start));
+    }
+    return result;
+}
+
+// One line per node in pre-order: parent index, name, then the 16 floats of the local transform
+static void saveText(Engine::Node& root, const std::string& path) {
+    std::ofstream file{path, std::ios::trunc};
+    file.precision(9);
+    size_t count = 0;
+    auto write = [&](auto& self, Engine::Node& node, long parent) -> void {
+        auto index = static_cast<long>(count++);
+        auto transform = node.getLocalTransform();
+        file << parent << ' ' << (node.getName().empty() ? "-" : node.getName());
+        for (int column = 0; column < 4; column++) {
+            for (int row = 0; row < 4; row++) {
+                file << ' ' << transform[column][row];
+            }
+        }
+        file << '\n';
+        node.forEachChild([&](Engine::Node& child) { self(self, child, index); });
+    };
+    write(write, root, -1);
+}
+
+static void loadText(Engine::Node& into, const std::string& path) {
+    std::ifstream file{path};
+    std::vector<Engine::Node*> created;
+    long parent;
+    std::string name;
+    glm::mat4 transform;
+    while (file >> parent >> name) {
+        for (int column = 0; column < 4; column++) {
+            for (int row = 0; row < 4; row++) {
+                file >> transform[column][row];
+            }
+        }
+        auto node = parent < 0 ? &into : created[parent]->emplace<Engine::Node>(name).get();
+        node->setLocalTransform(transform);
+        created.push_back(node);
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+
+    // Levels of 100 groups of 100 nodes each, down to count nodes
+    Engine::Node root;
+    std::vector<Engine::Node*> level{&root};
+    size_t created = 1;
+    while (created < count) {
+        std::vector<Engine::Node*> next;
+        for (auto parent : level) {
+            for (int i = 0; i < 100 && created < count; i++, created++) {
+                auto child = parent->emplace<Engine::Node>("node" + std::to_string(i)).get();
+                child->setLocalTransform(glm::translate(glm::mat4{1.f}, glm::vec3{float(i), float(created), 0.f}));
+                next.push_back(child);
+            }
+        }
+        level = std::move(next);
+    }
+
+    auto directory = std::filesystem::temp_directory_path();
+    auto binary_path = (directory / "bench_scene_file.glsc").string();
+    auto text_path = (directory / "bench_scene_file.txt").string();
+    if (!Engine::saveScene(root, binary_path)) {
+        return 1;
+    }
+    saveText(root, text_path);
+
+    // Every load builds a fresh tree, the previous one is destroyed outside the timed part
+    std::unique_ptr<Engine::Node> loaded;
+    auto fresh = [&]() { loaded = std::make_unique<Engine::Node>(); };
+
+    size_t touched = 0;
+    auto mapped = best([]() {}, [&]() {
+        Engine::MappedScene scene{binary_path};
+        for (uint32_t i = 0; i < scene.size(); i++) {
+            touched += scene.name(i).size() + static_cast<size_t>(scene.node(i).local_transform[3][1]);
+        }
+    });
+    auto binary = best(fresh, [&]() {
+        Engine::MappedScene scene{binary_path};
+        scene.instantiate(*loaded);
+    });
+    auto text = best(fresh, [&]() { loadText(*loaded, text_path); });
+
+    std::printf("%zu nodes, binary %.1f MB, text %.1f MB\n", count,
+                std::filesystem::file_size(binary_path) / 1048576.0, std::filesystem::file_size(text_path) / 1048576.0);
+    std::printf("%-36s %10.2f ms\n", "map and read every record", mapped);
+    std::printf("%-36s %10.2f ms\n", "binary: map and instantiate", binary);
+    std::printf("%-36s %10.2f ms\n", "text: parse and instantiate", text);
+
+    std::filesystem::remove(binary_path);
+    std::filesystem::remove(text_path);
+    return touched == 0 ? 1 : 0;
+}
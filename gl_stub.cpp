@@ -0,0 +1,137 @@
+#include "gl_stub.hpp"
+#include <cstdint>
+#include <cstring>
+#include <glad/glad.h>
+#include <unordered_map>
+#include <vector>
+
+static GlStubStats stats;
+static GLuint next_name = 1;
+static std::unordered_map<GLuint, std::vector<std::byte>> buffers;
+static std::unordered_map<GLenum, GLuint> bound;
+
+static std::vector<std::byte>& boundBuffer(GLenum target) { return buffers[bound[target]]; }
+
+static void APIENTRY genNames(GLsizei count, GLuint* names) {
+    stats.calls++;
+    for (GLsizei i = 0; i < count; i++) {
+        names[i] = next_name++;
+    }
+}
+
+static void APIENTRY deleteBuffers(GLsizei count, const GLuint* names) {
+    stats.calls++;
+    for (GLsizei i = 0; i < count; i++) {
+        buffers.erase(names[i]);
+    }
+}
+
+static void APIENTRY deleteNames(GLsizei, const GLuint*) { stats.calls++; }
+static GLuint APIENTRY createProgram() { return stats.calls++, next_name++; }
+static void APIENTRY deleteProgram(GLuint) { stats.calls++; }
+static void APIENTRY bindVertexArray(GLuint) { stats.calls++; }
+
+static void APIENTRY bindBuffer(GLenum target, GLuint buffer) {
+    stats.calls++;
+    bound[target] = buffer;
+}
+
+static void APIENTRY bufferData(GLenum target, GLsizeiptr size, const void* data, GLenum) {
+    stats.calls++;
+    stats.uploads++;
+    auto& buffer = boundBuffer(target);
+    buffer.assign(static_cast<size_t>(size), std::byte{0});
+    if (data) {
+        std::memcpy(buffer.data(), data, static_cast<size_t>(size));
+    }
+}
+
+static void APIENTRY bufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) {
+    stats.calls++;
+    stats.uploads++;
+    std::memcpy(boundBuffer(target).data() + offset, data, static_cast<size_t>(size));
+}
+
+static void APIENTRY getBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, void* data) {
+    stats.calls++;
+    std::memcpy(data, boundBuffer(target).data() + offset, static_cast<size_t>(size));
+}
+
+static void APIENTRY copyBufferSubData(GLenum read, GLenum write, GLintptr read_offset, GLintptr write_offset,
+                                       GLsizeiptr size) {
+    stats.calls++;
+    std::memmove(boundBuffer(write).data() + write_offset, boundBuffer(read).data() + read_offset,
+                 static_cast<size_t>(size));
+}
+
+static void* APIENTRY mapBufferRange(GLenum target, GLintptr offset, GLsizeiptr, GLbitfield) {
+    stats.calls++;
+    stats.uploads++;
+    return boundBuffer(target).data() + offset;
+}
+
+static GLboolean APIENTRY unmapBuffer(GLenum) { return stats.calls++, GL_TRUE; }
+static void APIENTRY vertexAttribPointer(GLuint, GLint, GLenum, GLboolean, GLsizei, const void*) { stats.calls++; }
+static void APIENTRY enableVertexAttribArray(GLuint) { stats.calls++; }
+static void APIENTRY vertexAttribDivisor(GLuint, GLuint) { stats.calls++; }
+
+static void countDraw() {
+    stats.calls++;
+    stats.draw_calls++;
+}
+static void APIENTRY drawArrays(GLenum, GLint, GLsizei) { countDraw(); }
+static void APIENTRY drawArraysInstanced(GLenum, GLint, GLsizei, GLsizei) { countDraw(); }
+static void APIENTRY drawElements(GLenum, GLsizei, GLenum, const void*) { countDraw(); }
+static void APIENTRY drawElementsBaseVertex(GLenum, GLsizei, GLenum, const void*, GLint) { countDraw(); }
+static void APIENTRY drawElementsInstanced(GLenum, GLsizei, GLenum, const void*, GLsizei) { countDraw(); }
+static void APIENTRY drawElementsInstancedBaseVertex(GLenum, GLsizei, GLenum, const void*, GLsizei, GLint) {
+    countDraw();
+}
+static void APIENTRY multiDrawElements(GLenum, const GLsizei*, GLenum, const void* const*, GLsizei) { countDraw(); }
+static void APIENTRY multiDrawElementsBaseVertex(GLenum, const GLsizei*, GLenum, const void* const*, GLsizei,
+                                                 const GLint*) {
+    countDraw();
+}
+
+// The stub runs every command right away, so fences are always signaled
+static GLsync APIENTRY fenceSync(GLenum, GLbitfield) { return stats.calls++, reinterpret_cast<GLsync>(next_name++); }
+static void APIENTRY deleteSync(GLsync) { stats.calls++; }
+static GLenum APIENTRY clientWaitSync(GLsync, GLbitfield, GLuint64) { return stats.calls++, GL_ALREADY_SIGNALED; }
+static void APIENTRY finish() { stats.calls++; }
+
+void installGlStub() {
+    glad_glGenBuffers = genNames;
+    glad_glGenVertexArrays = genNames;
+    glad_glGenTextures = genNames;
+    glad_glDeleteBuffers = deleteBuffers;
+    glad_glDeleteVertexArrays = deleteNames;
+    glad_glDeleteTextures = deleteNames;
+    glad_glCreateProgram = createProgram;
+    glad_glDeleteProgram = deleteProgram;
+    glad_glBindVertexArray = bindVertexArray;
+    glad_glBindBuffer = bindBuffer;
+    glad_glBufferData = bufferData;
+    glad_glBufferSubData = bufferSubData;
+    glad_glGetBufferSubData = getBufferSubData;
+    glad_glCopyBufferSubData = copyBufferSubData;
+    glad_glMapBufferRange = mapBufferRange;
+    glad_glUnmapBuffer = unmapBuffer;
+    glad_glVertexAttribPointer = vertexAttribPointer;
+    glad_glEnableVertexAttribArray = enableVertexAttribArray;
+    glad_glVertexAttribDivisor = vertexAttribDivisor;
+    glad_glDrawArrays = drawArrays;
+    glad_glDrawArraysInstanced = drawArraysInstanced;
+    glad_glDrawElements = drawElements;
+    glad_glDrawElementsBaseVertex = drawElementsBaseVertex;
+    glad_glDrawElementsInstanced = drawElementsInstanced;
+    glad_glDrawElementsInstancedBaseVertex = drawElementsInstancedBaseVertex;
+    glad_glMultiDrawElements = multiDrawElements;
+    glad_glMultiDrawElementsBaseVertex = multiDrawElementsBaseVertex;
+    glad_glFenceSync = fenceSync;
+    glad_glDeleteSync = deleteSync;
+    glad_glClientWaitSync = clientWaitSync;
+    glad_glFinish = finish;
+    stats = {};
+}
+
+GlStubStats& glStubStats() { return stats; }
@@ -0,0 +1,18 @@
+// Stand-in for a GL context, so that the GL side of the engine runs in tests and benchmarks without a window. Buffers
+// are kept in memory, so whatever was uploaded can be read back, and every call is counted. Nothing is rendered.
+
+#pragma once
+
+#include <cstddef>
+
+struct GlStubStats {
+    size_t calls = 0;      // every GL call
+    size_t draw_calls = 0; // glDraw* and glMultiDraw*
+    size_t uploads = 0;    // glBufferData, glBufferSubData and glMapBufferRange
+};
+
+// Points the glad function pointers the engine uses at the stub. Call once before creating any GL resource.
+void installGlStub();
+
+// Counters since installGlStub or the last reset
+GlStubStats& glStubStats();
@@ -1,82 +1,877 @@
 #pragma once
 
+#include "engine/commands.hpp"
+#include "engine/ecs.hpp"
+#include "engine/events.hpp"
+#include "engine/hash.hpp"
+#include "engine/jobs.hpp"
+#include "engine/pool.hpp"
+#include <algorithm>
 #include <cassert>
 #include <functional>
-#include <map>
+#include <glm/glm.hpp>
+#include <limits>
 #include <memory>
-#include <optional>
 #include <ranges>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
 
 namespace Engine {
 
+class Node;
+
+constexpr uint64_t ROOT_PATH_HASH = FNV_OFFSET_BASIS;
+constexpr uint32_t NO_SLOT = std::numeric_limits<uint32_t>::max();
+
+// Extends the hash of a parent path by one path segment (FNV-1a over "/name")
+constexpr uint64_t hashPathSegment(uint64_t parent_hash, std::string_view name) {
+    return hashFnv1a(name, hashFnv1a("/", parent_hash));
+}
+
+// Generational reference to a node. Stays cheap to copy and safely turns empty once the node is removed, even if its
+// pool slot has been reused since.
+class NodeHandle {
+  public:
+    NodeHandle() = default;
+    explicit NodeHandle(Node* node);
+
+    Node* get() const { return node && (!generation_ptr || *generation_ptr == generation) ? node : nullptr; }
+    Node* operator->() const {
+        auto ptr = get();
+        assert(ptr && "Empty or stale node handle");
+        return ptr;
+    }
+    Node& operator*() const { return *operator->(); }
+    explicit operator bool() const { return get() != nullptr; }
+
+    template <typename T> T* as() const { return dynamic_cast<T*>(get()); }
+
+    bool operator==(const NodeHandle& other) const { return get() == other.get(); }
+
+  private:
+    Node* node = nullptr;
+    const uint32_t* generation_ptr = nullptr; // nullptr for nodes that were not allocated from a pool, e.g. roots
+    uint32_t generation = 0;
+};
+
+// Releases a pooled node back to the pool of its concrete type
+struct NodeDeleter {
+    void (*release)(Node*);
+    void operator()(Node* node) const { release(node); }
+};
+
+using NodePtr = std::unique_ptr<Node, NodeDeleter>;
+
+struct PathLookupStats {
+    size_t hits;
+    size_t misses;
+};
+
+// Runs a node's preUpdate or postUpdate, see NodeTree::pre_updates
+using NodeUpdateFn = void (*)(Node&, float);
+
+// State shared by every node of a tree, owned by the root
+struct NodeTree {
+    CommandBuffer commands;
+    EventQueue events;
+
+    // Absolute path hash -> node, kept up to date by Node::add and Node::remove. Paths whose hashes collide share a
+    // key, lookups tell them apart by their names.
+    std::unordered_multimap<uint64_t, Node*> path_index;
+    std::atomic<size_t> lookup_hits{0};
+    std::atomic<size_t> lookup_misses{0};
+
+    // Per node state, indexed by Node::slot. update and updateTransforms sweep these arrays and only touch a node to
+    // run its own preUpdate or postUpdate, so their cost does not depend on where the pools placed the nodes. While
+    // ordered, the slots follow the tree's depth-first order and a subtree is the slot range
+    // [slot, subtree_ends[slot]). Added and moved nodes get new slots at the end, their old slots and those of
+    // removed nodes are left with nullptr in nodes, and ordered is cleared until the next sweep lays the arrays out
+    // again.
+    std::vector<Node*> nodes;
+    std::vector<uint32_t> parent_slots; // NO_SLOT for the root
+    std::vector<uint32_t> subtree_ends; // only while ordered
+    // The node type's override, called without a virtual call. nullptr where the type does not override it.
+    std::vector<NodeUpdateFn> pre_updates;
+    std::vector<NodeUpdateFn> post_updates;
+    std::vector<glm::mat4> local_transforms;
+    std::vector<glm::mat4> world_transforms;
+    std::vector<uint8_t> transform_dirty;
+    std::vector<uint32_t> name_offsets; // into names
+    std::vector<uint32_t> name_lengths;
+    std::string names;
+    bool ordered = false;
+    std::atomic<int> sweeping{0}; // the arrays are not laid out again while a sweep reads them
+
+    // Slots whose local transform changed since the last Node::updateTransforms. Slots left by removed or moved
+    // nodes since are skipped, so neither has to search the list.
+    std::mutex dirty_mutex;
+    std::vector<uint32_t> dirty_slots;
+    size_t transforms_recomputed = 0; // during the last updateTransforms
+
+    std::string_view name(uint32_t slot) const {
+        return std::string_view{names}.substr(name_offsets[slot], name_lengths[slot]);
+    }
+};
+
 class Node {
   public:
+    Node() = default;
     virtual ~Node() = default;
 
-    std::string getPath() const { 
-        using namespace std::ranges;
-        return path | views::join_with('/') | to<std::string>();
+    // Nodes are moved into their parent by add, never copied. Moving a node that is already part of a tree is not
+    // supported, subtrees are re-linked when they are added.
+    Node(Node&&) = default;
+    Node& operator=(Node&&) = default;
+
+    // Views the tree's string table, valid until the next node is added to the tree
+    std::string_view getName() const {
+        auto tree = slotTree();
+        return tree ? tree->name(slot) : std::string_view{};
     }
 
-    virtual void preUpdate(float deltaTime) {}
+    // The names from below the root down to this node, joined by '/'. Empty for the root.
+    std::string getPath() const {
+        std::string path;
+        for (auto node = this; node->parent; node = node->parent) {
+            path.insert(0, node->getName());
+            if (node->parent->parent) {
+                path.insert(0, 1, '/');
+            }
+        }
+        return path;
+    }
 
-    virtual void update(float deltaTime) {
-        preUpdate(deltaTime);
+    // Behaviour goes in preUpdate and postUpdate, which update and parallelUpdate both call around the children.
+    // update itself is final, an override would be skipped by parallelUpdate and never run for child nodes.
+    virtual void preUpdate([[maybe_unused]] float deltaTime) {}
+    virtual void postUpdate([[maybe_unused]] float deltaTime) {}
 
-        for (auto& child : children) {
-            child.second->update(deltaTime);
+    virtual void update(float deltaTime) final {
+        auto& tree = getRoot().getTree();
+        if (!tree.ordered && tree.sweeping == 0) {
+            getRoot().rebuildOrder();
         }
+        updateSubtree(deltaTime);
 
-        postUpdate(deltaTime);
+        if (!parent) {
+            sync();
+        }
+    }
+
+    // Opt-in parallel variant of update: down to parallel_depth levels below this node every child subtree runs as
+    // its own job, deeper subtrees are updated serially inside those jobs. Each node still runs preUpdate before and
+    // postUpdate after all of its children, but siblings (and their subtrees) may run concurrently. A node's
+    // postUpdate is a job that depends on its children's, so jobs never wait on each other and only the calling
+    // thread waits, once.
+    void parallelUpdate(float deltaTime, JobSystem& jobs, size_t parallel_depth = 2) {
+        auto& tree = getRoot().getTree();
+        if (!tree.ordered && tree.sweeping == 0) {
+            getRoot().rebuildOrder();
+        }
+
+        auto done = jobs.create(nullptr);
+        tree.sweeping++;
+        scheduleUpdate(deltaTime, jobs, parallel_depth, done);
+        jobs.run(done);
+        jobs.wait(done);
+        tree.sweeping--;
+
+        if (!parent) {
+            sync();
+        }
     }
 
-    virtual void postUpdate(float deltaTime) {}
+    // Constructs a T in place, in the slab pool for T, and attaches it as a child
+    template <typename T, typename... Args> NodeHandle emplace(const std::string& name, Args&&... args) {
+        static_assert(std::is_base_of_v<Node, T>, "T must derive from Engine::Node");
+        assert(!getChild(name) && "Child already exists");
+
+        auto& pool = Pool<T>::instance();
+        T* child = pool.create(std::forward<Args>(args)...);
+        child->pool_generation = Pool<T>::generation(child);
 
-    template <typename T> void add(const std::string& name, T&& child) {
-        auto it = children.find(name);
-        assert(it == children.end() && "Child already exists");
+        // Events queued on the child while it was a root of its own are delivered before it joins this tree, the
+        // state of its subtree moves over from its tree's slots
+        std::unique_ptr<NodeTree> own_tree;
+        if (child->tree) {
+            child->dispatchEvents();
+            own_tree = std::move(child->tree);
+        }
+        auto& tree = getRoot().getTree();
+        child->attach(this, name, own_tree.get(), tree);
+        tree.pre_updates[child->slot] = preUpdateOf<T>();
+        tree.post_updates[child->slot] = postUpdateOf<T>();
+        child->markTransformDirty();
+        tree.ordered = false;
 
-        auto child_ptr = std::make_shared<T>(child);
-        child_ptr->root = root;
+        auto release = [](Node* node) { Pool<T>::instance().release(static_cast<T*>(node)); };
+        child->sibling_index = static_cast<uint32_t>(children.size());
+        children.emplace_back(child, NodeDeleter{release});
+        return NodeHandle{child};
+    }
 
-        children[name] = child_ptr;
+    // Moves child into a pooled node of the same type
+    template <typename T> NodeHandle add(const std::string& name, T&& child) {
+        return emplace<std::remove_cvref_t<T>>(name, std::forward<T>(child));
     }
 
+    // Destroys the child's subtree and returns its nodes to their pools. Handles to them become empty.
     void remove(const std::string& name) {
-        auto it = children.find(name);
-        assert(it != children.end() && "Child does not exist");
+        auto removed = getChild(name).get();
+        assert(removed && "Child does not exist");
+
+        auto& tree = getRoot().getTree();
+        tree.events.cancel([removed](Node* target) { return target->isDescendantOf(removed); });
+        removed->unindex(tree);
+        removed->releaseSlots(tree);
+        removed->destroyEntities();
+
+        takeChild(*removed).reset();
+    }
+
+    // Moves this node and its subtree below new_parent, under new_name
+    void reparent(Node& new_parent, const std::string& new_name) {
+        assert(parent && "Cannot reparent a root");
+        assert(!new_parent.isDescendantOf(this) && "Cannot move a node below itself");
+        assert(!new_parent.getChild(new_name) && "Child already exists");
+
+        auto& old_tree = getRoot().getTree();
+        auto& new_tree = new_parent.getRoot().getTree();
+        if (&old_tree != &new_tree) {
+            old_tree.events.cancel([this](Node* target) { return target->isDescendantOf(this); });
+        }
+        unindex(old_tree);
+
+        auto owned = parent->takeChild(*this);
+        attach(&new_parent, new_name, &old_tree, new_tree);
+        markTransformDirty();
+        new_tree.ordered = false;
+
+        sibling_index = static_cast<uint32_t>(new_parent.children.size());
+        new_parent.children.push_back(std::move(owned));
+    }
+
+    // Deferred versions of the structural operations. They can be recorded from update and from parallelUpdate jobs,
+    // and are applied in recording order by the root's sync. Operations whose nodes are gone by then are skipped.
+    template <typename T, typename... Args> void deferEmplace(std::string name, Args&&... args) {
+        getRoot().getTree().commands.record(
+            [target = NodeHandle{this}, name = std::move(name), ... args = std::forward<Args>(args)]() mutable {
+                if (target && !target->getChild(name)) {
+                    target->emplace<T>(name, std::move(args)...);
+                }
+            });
+    }
+
+    template <typename T> void deferAdd(std::string name, T&& child) {
+        deferEmplace<std::remove_cvref_t<T>>(std::move(name), std::forward<T>(child));
+    }
+
+    void deferRemove(std::string name) {
+        getRoot().getTree().commands.record([target = NodeHandle{this}, name = std::move(name)]() {
+            if (target && target->getChild(name)) {
+                target->remove(name);
+            }
+        });
+    }
+
+    void deferReparent(NodeHandle new_parent, std::string new_name) {
+        getRoot().getTree().commands.record(
+            [target = NodeHandle{this}, new_parent, new_name = std::move(new_name)]() {
+                if (target && new_parent && !new_parent->isDescendantOf(target.get())) {
+                    target->reparent(*new_parent, new_name);
+                }
+            });
+    }
+
+    // Like trigger, but delivered when the command buffer is applied, in order with the structural commands
+    template <typename E> void deferTrigger(E event, std::string relative_path = "..") {
+        getRoot().getTree().commands.record(
+            [target = NodeHandle{this}, event = std::move(event), relative_path = std::move(relative_path)]() {
+                if (auto node = target ? target->find(relative_path) : NodeHandle{}) {
+                    node->deliver(eventId<E>(), &event);
+                }
+            });
+    }
+
+    // Frame sync point, run by the root at the end of update: applies deferred commands, then delivers queued events,
+    // then propagates transforms.
+    void sync() {
+        assert(!parent && "Only the tree root can sync");
+        if (tree) {
+            tree->commands.apply();
+        }
+        dispatchEvents();
+        updateTransforms();
+    }
+
+    // Looked up in the tree's path index, so the cost does not grow with the number of children
+    NodeHandle getChild(std::string_view name) {
+        auto [first, last] = getRoot().getTree().path_index.equal_range(hashPathSegment(path_hash, name));
+        for (auto it = first; it != last; ++it) {
+            if (it->second->parent == this && it->second->getName() == name) {
+                return NodeHandle{it->second};
+            }
+        }
+        return {};
+    }
+
+    // Calls fn(Node&) for every child, in the order they were added
+    template <typename F> void forEachChild(F&& fn) {
+        for (auto& child : children) {
+            if (child) {
+                fn(*child);
+            }
+        }
+    }
+
+    Node* getParent() const { return parent; }
+
+    Node& getRoot() { return root ? *root : *this; }
+
+    bool isDescendantOf(const Node* ancestor) const {
+        for (auto node = this; node; node = node->parent) {
+            if (node == ancestor) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Resolves a '/' separated path, absolute when it starts with '/' and relative to this node otherwise. ".."
+    // steps to the parent, "." and empty segments are skipped. Named segments are folded into a path hash and looked
+    // up once in the tree's index, so the lookup neither walks the children maps nor allocates. The names of the
+    // indexed node are compared with the path, so a hash collision never resolves to the wrong node.
+    NodeHandle find(std::string_view relative_path) {
+        Node* node = relative_path.starts_with('/') ? &getRoot() : this;
+        auto& tree = node->getRoot().getTree();
+
+        auto hash = node->path_hash;
+        std::string_view pending; // named segments hash is ahead of node by
+
+        auto lookup = [&]() -> Node* {
+            auto [first, last] = tree.path_index.equal_range(hash);
+            for (auto it = first; it != last; ++it) {
+                if (it->second->isReachedFrom(node, pending)) {
+                    return it->second;
+                }
+            }
+            return nullptr;
+        };
+
+        for (auto segment : relative_path | std::views::split('/')) {
+            std::string_view name{segment.begin(), segment.end()};
+            if (name.empty() || name == ".") {
+                continue;
+            }
+
+            if (name == "..") {
+                if (!pending.empty()) {
+                    node = lookup();
+                    pending = {};
+                }
+                node = node ? node->parent : nullptr;
+                if (!node) {
+                    tree.lookup_misses.fetch_add(1, std::memory_order_relaxed);
+                    return {};
+                }
+                hash = node->path_hash;
+                continue;
+            }
+
+            hash = hashPathSegment(hash, name);
+            pending = pending.empty() ? name : std::string_view{pending.data(), name.data() + name.size()};
+        }
+
+        if (!pending.empty()) {
+            node = lookup();
+        }
+
+        (node ? tree.lookup_hits : tree.lookup_misses).fetch_add(1, std::memory_order_relaxed);
+        return NodeHandle{node};
+    }
+
+    PathLookupStats getPathLookupStats() {
+        auto& tree = getRoot().getTree();
+        return {tree.lookup_hits.load(), tree.lookup_misses.load()};
+    }
+
+    void resetPathLookupStats() {
+        auto& tree = getRoot().getTree();
+        tree.lookup_hits = 0;
+        tree.lookup_misses = 0;
+    }
+
+    // Lets the node own an ECS entity, which is destroyed once the node's subtree is removed and released
+    void setEntity(World& world, Entity entity) {
+        this->world = &world;
+        this->entity = entity;
+    }
+
+    Entity getEntity() const { return entity; }
+    World* getWorld() const { return world; }
+
+    glm::mat4 getLocalTransform() const {
+        auto tree = slotTree();
+        return tree ? tree->local_transforms[slot] : glm::mat4{1.f};
+    }
 
-        children.erase(it);
+    // World transform as of the last updateTransforms, which the root runs at the end of every update
+    glm::mat4 getWorldTransform() const {
+        auto tree = slotTree();
+        return tree ? tree->world_transforms[slot] : glm::mat4{1.f};
     }
 
-    std::optional<std::shared_ptr<Node>> getChild(const std::string& name) {
-        auto it = children.find(name);
-        if (it != children.end()) {
-            return it->second;
+    void setLocalTransform(const glm::mat4& transform) {
+        getRoot().getTree().local_transforms[slot] = transform;
+        markTransformDirty();
+    }
+
+    // Recomputes the world transforms of every subtree whose local transform changed, parents before children.
+    // Untouched subtrees are not visited, so the cost follows what moved rather than the size of the tree. Dirty
+    // subtrees are swept in slot order, each one a contiguous range of the tree's depth-first order.
+    void updateTransforms() {
+        assert(!parent && "Transforms are updated from the tree root");
+        auto& tree = getTree();
+        if (!tree.ordered && tree.sweeping == 0) {
+            rebuildOrder();
+        }
+        std::lock_guard lock{tree.dirty_mutex};
+
+        auto& dirty = tree.dirty_slots;
+        std::erase_if(dirty, [&tree](uint32_t dirty_slot) { return !tree.nodes[dirty_slot]; });
+
+        size_t recomputed = 0;
+        if (tree.ordered) {
+            std::ranges::sort(dirty);
+
+            uint32_t swept_end = 0;
+            for (auto dirty_slot : dirty) {
+                // Inside the range of a dirty ancestor, recomputed already
+                if (dirty_slot < swept_end) {
+                    continue;
+                }
+                swept_end = tree.subtree_ends[dirty_slot];
+                for (auto i = dirty_slot; i < swept_end; i++) {
+                    auto parent_slot = tree.parent_slots[i];
+                    tree.world_transforms[i] = parent_slot == NO_SLOT
+                                                   ? tree.local_transforms[i]
+                                                   : tree.world_transforms[parent_slot] * tree.local_transforms[i];
+                    tree.transform_dirty[i] = false;
+                }
+                recomputed += swept_end - dirty_slot;
+            }
+        } else {
+            // Called from inside an update sweep after a structural change, where parents may have been given later
+            // slots than their children. Walk the children of the shallowest dirty nodes instead.
+            auto depth = [&tree](uint32_t dirty_slot) {
+                size_t result = 0;
+                for (auto s = tree.parent_slots[dirty_slot]; s != NO_SLOT; s = tree.parent_slots[s]) {
+                    result++;
+                }
+                return result;
+            };
+            std::vector<std::pair<size_t, uint32_t>> by_depth;
+            for (auto dirty_slot : dirty) {
+                by_depth.emplace_back(depth(dirty_slot), dirty_slot);
+            }
+            std::ranges::sort(by_depth);
+            for (auto [_, dirty_slot] : by_depth) {
+                if (tree.transform_dirty[dirty_slot]) {
+                    recomputed += tree.nodes[dirty_slot]->recomputeWorldTransforms(tree);
+                }
+            }
+        }
+        dirty.clear();
+        tree.transforms_recomputed = recomputed;
+    }
+
+    // Number of world matrices recomputed by the last updateTransforms
+    size_t getTransformsRecomputed() { return getRoot().getTree().transforms_recomputed; }
+
+    // Registers a listener for events of type E. The callback takes (const E&) or (const E&, EventContext&), any
+    // number of listeners may be registered for the same event.
+    template <typename E, typename F> ListenerId on(F&& callback) {
+        auto id = next_listener_id++;
+        EventListener listener{eventId<E>(), id, makeEventCallback<E>(std::forward<F>(callback))};
+        if (delivering > 0) {
+            added_listeners.push_back(std::move(listener));
+        } else {
+            listeners.push_back(std::move(listener));
+        }
+        return id;
+    }
+
+    void off(ListenerId id) {
+        if (delivering > 0) {
+            removed_listeners.push_back(id);
+            return;
         }
-        return std::nullopt;
+        std::erase_if(listeners, [id](const EventListener& listener) { return listener.id == id; });
     }
 
-    void on(const std::string& name, std::function<void(void*)> callback) {
-        auto it = callbacks.find(name);
-        assert(it == callbacks.end() && "Callback already exists");
+    // Immediately delivers event to the node at relative_path, then bubbles it up through that node's ancestors
+    // until a listener calls EventContext::stopPropagation.
+    template <typename E> void trigger(const E& event, std::string_view relative_path = "..") {
+        Node* target = find(relative_path).get();
+        assert(target && "No node at relative_path");
 
-        callbacks[name] = callback;
+        target->deliver(eventId<E>(), &event);
     }
 
-    void trigger(const std::string& name, void* data, const std::string& relative_path = "..") {
-        auto it = callbacks.find(name);
-        assert(it != callbacks.end() && "Callback does not exist");
+    // Same routing as trigger, but the event is queued on the tree root and delivered at the end of the root's
+    // update (or on an explicit dispatchEvents call). Safe to call from parallelUpdate jobs.
+    template <typename E> void post(E event, std::string_view relative_path = "..") {
+        Node* target = find(relative_path).get();
+        assert(target && "No node at relative_path");
+
+        getRoot().getTree().events.post(target, std::move(event));
+    }
 
-        it->second(data);
+    void dispatchEvents() {
+        assert(!parent && "Events are dispatched from the tree root");
+        if (tree) {
+            tree->events.dispatch([](Node* target, EventId id, const void* payload) {
+                target->deliver(id, payload);
+            });
+        }
     }
 
   private:
-    std::shared_ptr<Node> root;
-    std::vector<std::string> path; 
-    std::map<std::string, std::shared_ptr<Node>> children;
-    std::map<std::string, std::function<void(void*)>> callbacks;
+    Node* parent = nullptr;
+    Node* root = nullptr; // nullptr when this node is a root itself
+    uint64_t path_hash = ROOT_PATH_HASH;
+    std::vector<NodePtr> children; // in the order they were added, nullptr where a child was taken out
+    size_t taken_children = 0;
+    uint32_t sibling_index = 0; // in the parent's children
+    const uint32_t* pool_generation = nullptr;
+    uint32_t slot = NO_SLOT; // of the node's state in the tree's arrays, NO_SLOT until it joins a tree
+
+    std::vector<EventListener> listeners;
+    std::vector<EventListener> added_listeners;
+    std::vector<ListenerId> removed_listeners;
+    ListenerId next_listener_id = 0;
+    int delivering = 0;
+
+    World* world = nullptr;
+    Entity entity;
+    std::unique_ptr<NodeTree> tree; // only set on the root, created on first use
+
+    NodeTree& getTree() {
+        assert(!root && "The tree is owned by the root");
+        if (!tree) {
+            tree = std::make_unique<NodeTree>();
+            appendSlot(*tree, NO_SLOT, {}, nullptr);
+            // The root was not constructed by emplace, so its type is not known
+            tree->pre_updates[slot] = [](Node& node, float deltaTime) { node.preUpdate(deltaTime); };
+            tree->post_updates[slot] = [](Node& node, float deltaTime) { node.postUpdate(deltaTime); };
+        }
+        return *tree;
+    }
+
+    // The tree holding this node's slot, nullptr if it has none
+    NodeTree* slotTree() const {
+        auto owner = root ? root->tree.get() : tree.get();
+        return owner && slot != NO_SLOT ? owner : nullptr;
+    }
+
+    // What emplace stores to call T's overrides, nullptr where T inherits Node's. The pointer to member of a method
+    // T does not override is a pointer to a member of Node.
+    template <typename T> static NodeUpdateFn preUpdateOf() {
+        if constexpr (std::is_same_v<decltype(&T::preUpdate), void (Node::*)(float)>) {
+            return nullptr;
+        } else {
+            return [](Node& node, float deltaTime) { static_cast<T&>(node).T::preUpdate(deltaTime); };
+        }
+    }
+
+    template <typename T> static NodeUpdateFn postUpdateOf() {
+        if constexpr (std::is_same_v<decltype(&T::postUpdate), void (Node::*)(float)>) {
+            return nullptr;
+        } else {
+            return [](Node& node, float deltaTime) { static_cast<T&>(node).T::postUpdate(deltaTime); };
+        }
+    }
+
+    // Takes child out of children, leaving a gap so that later siblings keep their index. The gaps are closed once
+    // they outnumber the children, which keeps removal constant time in the amortized sense.
+    NodePtr takeChild(Node& child) {
+        auto owned = std::move(children[child.sibling_index]);
+        taken_children++;
+
+        if (taken_children * 2 > children.size()) {
+            std::erase(children, nullptr);
+            for (uint32_t i = 0; i < children.size(); i++) {
+                children[i]->sibling_index = i;
+            }
+            taken_children = 0;
+        }
+        return owned;
+    }
+
+    // Sweeps the subtree's slot range: preUpdate for every slot in order, then postUpdate for every subtree that ends
+    // at that slot, innermost first. Nodes removed or moved during the sweep have left nullptr and are skipped, nodes
+    // added during it are past the range. The arrays are indexed anew on every call, as those nodes grow them.
+    void updateSubtree(float deltaTime) {
+        auto& tree = getRoot().getTree();
+        if (!tree.ordered || slot == NO_SLOT) {
+            updateChildren(deltaTime);
+            return;
+        }
+
+        tree.sweeping++;
+        auto begin = slot, end = tree.subtree_ends[slot];
+        for (auto i = begin; i < end; i++) {
+            if (auto node = tree.nodes[i]; node && tree.pre_updates[i]) {
+                tree.pre_updates[i](*node, deltaTime);
+            }
+            for (auto s = i; tree.subtree_ends[s] == i + 1; s = tree.parent_slots[s]) {
+                if (auto node = tree.nodes[s]; node && tree.post_updates[s]) {
+                    tree.post_updates[s](*node, deltaTime);
+                }
+                if (s == begin) {
+                    break;
+                }
+            }
+        }
+        tree.sweeping--;
+    }
+
+    // Recursive walk, for updates that run while the depth-first order is out of date
+    void updateChildren(float deltaTime) {
+        preUpdate(deltaTime);
+
+        forEachChild([deltaTime](Node& child) { child.updateChildren(deltaTime); });
+
+        postUpdate(deltaTime);
+    }
+
+    // Lays the tree's arrays out in depth-first order, children in the order they were added, dropping the slots
+    // nodes have left and the names only those used. Iterative, so that deep trees do not overflow the stack.
+    void rebuildOrder() {
+        auto& tree = getTree();
+        std::vector<Node*> nodes;
+        std::vector<uint32_t> parent_slots;
+        std::vector<uint32_t> old_slots;
+        std::vector<uint32_t> new_slots(tree.nodes.size(), NO_SLOT);
+
+        std::vector<std::pair<Node*, uint32_t>> stack{{this, NO_SLOT}};
+        while (!stack.empty()) {
+            auto [node, parent_slot] = stack.back();
+            stack.pop_back();
+
+            old_slots.push_back(node->slot);
+            node->slot = new_slots[node->slot] = static_cast<uint32_t>(nodes.size());
+            nodes.push_back(node);
+            parent_slots.push_back(parent_slot);
+            for (auto& child : node->children | std::views::reverse) {
+                if (child) {
+                    stack.emplace_back(child.get(), node->slot);
+                }
+            }
+        }
+
+        auto permute = [&old_slots](auto& values) {
+            std::remove_reference_t<decltype(values)> permuted;
+            permuted.reserve(old_slots.size());
+            for (auto old_slot : old_slots) {
+                permuted.push_back(values[old_slot]);
+            }
+            values = std::move(permuted);
+        };
+        std::string names;
+        std::vector<uint32_t> name_offsets;
+        for (auto old_slot : old_slots) {
+            name_offsets.push_back(static_cast<uint32_t>(names.size()));
+            names += tree.name(old_slot);
+        }
+        permute(tree.pre_updates);
+        permute(tree.post_updates);
+        permute(tree.local_transforms);
+        permute(tree.world_transforms);
+        permute(tree.transform_dirty);
+        permute(tree.name_lengths);
+        tree.nodes = std::move(nodes);
+        tree.parent_slots = std::move(parent_slots);
+        tree.name_offsets = std::move(name_offsets);
+        tree.names = std::move(names);
+
+        for (auto& dirty_slot : tree.dirty_slots) {
+            dirty_slot = new_slots[dirty_slot];
+        }
+        std::erase(tree.dirty_slots, NO_SLOT);
+
+        // Every parent precedes its descendants, so one backwards pass extends each parent's range over its children
+        tree.subtree_ends.resize(tree.nodes.size());
+        for (uint32_t i = 0; i < tree.nodes.size(); i++) {
+            tree.subtree_ends[i] = i + 1;
+        }
+        for (auto i = static_cast<uint32_t>(tree.nodes.size()); i-- > 1;) {
+            auto& end = tree.subtree_ends[tree.parent_slots[i]];
+            end = std::max(end, tree.subtree_ends[i]);
+        }
+        tree.ordered = true;
+    }
+
+    // Appends a slot for this node to tree's arrays, with the given state and no update functions
+    void appendSlot(NodeTree& tree, uint32_t parent_slot, std::string_view name, const glm::mat4* local_transform) {
+        slot = static_cast<uint32_t>(tree.nodes.size());
+        tree.nodes.push_back(this);
+        tree.parent_slots.push_back(parent_slot);
+        tree.pre_updates.push_back(nullptr);
+        tree.post_updates.push_back(nullptr);
+        tree.local_transforms.push_back(local_transform ? *local_transform : glm::mat4{1.f});
+        tree.world_transforms.push_back(tree.local_transforms.back());
+        tree.transform_dirty.push_back(false);
+        tree.name_offsets.push_back(static_cast<uint32_t>(tree.names.size()));
+        tree.name_lengths.push_back(static_cast<uint32_t>(name.size()));
+        tree.names += name;
+    }
+
+    // Leaves the subtree's slots in old_tree empty, until the next rebuild drops them
+    void releaseSlots(NodeTree& old_tree) {
+        if (slot != NO_SLOT) {
+            old_tree.nodes[slot] = nullptr;
+            slot = NO_SLOT;
+        }
+        old_tree.ordered = false;
+        forEachChild([&](Node& child) { child.releaseSlots(old_tree); });
+    }
+
+    // Runs preUpdate, then schedules the children's subtrees and a postUpdate job that depends on all of them. group
+    // is kept unfinished until that postUpdate is done.
+    void scheduleUpdate(float deltaTime, JobSystem& jobs, size_t parallel_depth, const JobHandle& group) {
+        if (parallel_depth == 0 || children.size() - taken_children < 2) {
+            updateSubtree(deltaTime);
+            return;
+        }
+
+        preUpdate(deltaTime);
+
+        auto children_done = jobs.create(nullptr, group);
+        forEachChild([&](Node& child) {
+            auto node = &child;
+            jobs.schedule([=, &jobs]() { node->scheduleUpdate(deltaTime, jobs, parallel_depth - 1, children_done); },
+                          children_done);
+        });
+        auto post = jobs.create([this, deltaTime]() { postUpdate(deltaTime); }, group);
+        jobs.depend(post, children_done);
+        jobs.run(children_done);
+        jobs.run(post);
+    }
+
+    // Gives the subtree new slots at the end of new_tree's arrays, below new_parent. The state it had in old_tree, if
+    // any, moves along and the old slots are left empty. old_tree may be new_tree.
+    void attach(Node* new_parent, std::string_view new_name, NodeTree* old_tree, NodeTree& new_tree) {
+        parent = new_parent;
+        root = &new_parent->getRoot();
+        path_hash = hashPathSegment(parent->path_hash, new_name);
+        new_tree.path_index.emplace(path_hash, this);
+
+        auto old_slot = slot;
+        if (old_tree && old_slot != NO_SLOT) {
+            appendSlot(new_tree, parent->slot, new_name, &old_tree->local_transforms[old_slot]);
+            new_tree.pre_updates[slot] = old_tree->pre_updates[old_slot];
+            new_tree.post_updates[slot] = old_tree->post_updates[old_slot];
+            old_tree->nodes[old_slot] = nullptr;
+            old_tree->ordered = false;
+        } else {
+            appendSlot(new_tree, parent->slot, new_name, nullptr);
+        }
+
+        forEachChild([&](Node& child) { child.attach(this, old_tree->name(child.slot), old_tree, new_tree); });
+    }
+
+    void markTransformDirty() {
+        auto& tree = getRoot().getTree();
+        std::lock_guard lock{tree.dirty_mutex};
+        if (!tree.transform_dirty[slot]) {
+            tree.transform_dirty[slot] = true;
+            tree.dirty_slots.push_back(slot);
+        }
+    }
+
+    size_t recomputeWorldTransforms(NodeTree& tree) {
+        auto parent_slot = tree.parent_slots[slot];
+        tree.world_transforms[slot] = parent_slot == NO_SLOT
+                                          ? tree.local_transforms[slot]
+                                          : tree.world_transforms[parent_slot] * tree.local_transforms[slot];
+        tree.transform_dirty[slot] = false;
+
+        size_t recomputed = 1;
+        forEachChild([&](Node& child) { recomputed += child.recomputeWorldTransforms(tree); });
+        return recomputed;
+    }
+
+    friend class NodeHandle;
+
+    void destroyEntities() {
+        if (world) {
+            world->destroy(entity);
+            world = nullptr;
+        }
+        forEachChild([](Node& child) { child.destroyEntities(); });
+    }
+
+    void unindex(NodeTree& old_tree) {
+        auto [first, last] = old_tree.path_index.equal_range(path_hash);
+        for (auto it = first; it != last; ++it) {
+            if (it->second == this) {
+                old_tree.path_index.erase(it);
+                break;
+            }
+        }
+        forEachChild([&](Node& child) { child.unindex(old_tree); });
+    }
+
+    // Whether following the named segments of path, which holds no "..", from base leads to this node
+    bool isReachedFrom(const Node* base, std::string_view path) const {
+        auto node = this;
+        while (!path.empty()) {
+            auto slash = path.rfind('/');
+            auto segment = slash == std::string_view::npos ? path : path.substr(slash + 1);
+            path = path.substr(0, slash == std::string_view::npos ? 0 : slash);
+            if (segment.empty() || segment == ".") {
+                continue;
+            }
+            if (!node || node->getName() != segment) {
+                return false;
+            }
+            node = node->parent;
+        }
+        return node == base;
+    }
+
+    void deliver(EventId id, const void* payload) {
+        EventContext context{this, this};
+
+        for (Node* node = this; node && !context.stopped; node = node->parent) {
+            context.current = node;
+            node->delivering++;
+
+            // Listeners added or removed by callbacks only take effect once delivery on this node is done
+            for (size_t i = 0, count = node->listeners.size(); i < count; i++) {
+                if (node->listeners[i].event == id) {
+                    node->listeners[i].callback(payload, context);
+                }
+            }
+
+            if (--node->delivering == 0) {
+                std::ranges::move(node->added_listeners, std::back_inserter(node->listeners));
+                node->added_listeners.clear();
+                for (auto removed : node->removed_listeners) {
+                    node->off(removed);
+                }
+                node->removed_listeners.clear();
+            }
+        }
+    }
 };
 
+inline NodeHandle::NodeHandle(Node* node)
+    : node{node}, generation_ptr{node ? node->pool_generation : nullptr},
+      generation{generation_ptr ? *generation_ptr : 0} {}
+
 }; // namespace Engine
@@ -0,0 +1,151 @@
+#include "engine/bounds.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define ENGINE_BOUNDS_SSE
+#endif
+
+namespace Engine {
+
+// Minimum and maximum x, y and z of count points stored Stride floats apart
+template <size_t Stride> static void reduceMinMax(const float* points, size_t count, glm::vec3& min, glm::vec3& max) {
+    size_t i = 0;
+#ifdef ENGINE_BOUNDS_SSE
+    constexpr size_t registers = Stride == 4 ? 1 : 3; // three registers hold four packed vec3s
+    constexpr size_t step = Stride == 4 ? 1 : 4;
+    __m128 lo[registers], hi[registers];
+    for (size_t r = 0; r < registers; r++) {
+        lo[r] = _mm_set1_ps(std::numeric_limits<float>::max());
+        hi[r] = _mm_set1_ps(std::numeric_limits<float>::lowest());
+    }
+    for (; i + step <= count; i += step) {
+        for (size_t r = 0; r < registers; r++) {
+            auto v = _mm_loadu_ps(points + i * Stride + r * 4);
+            lo[r] = _mm_min_ps(lo[r], v);
+            hi[r] = _mm_max_ps(hi[r], v);
+        }
+    }
+
+    // Float k of the registers stored one after the other holds component k % Stride; w lanes are skipped
+    alignas(16) float lows[registers * 4], highs[registers * 4];
+    for (size_t r = 0; r < registers; r++) {
+        _mm_store_ps(lows + r * 4, lo[r]);
+        _mm_store_ps(highs + r * 4, hi[r]);
+    }
+    for (size_t k = 0; k < registers * 4; k++) {
+        if (k % Stride < 3) {
+            min[k % Stride] = std::min(min[k % Stride], lows[k]);
+            max[k % Stride] = std::max(max[k % Stride], highs[k]);
+        }
+    }
+#endif
+    for (; i < count; i++) {
+        for (int c = 0; c < 3; c++) {
+            min[c] = std::min(min[c], points[i * Stride + c]);
+            max[c] = std::max(max[c], points[i * Stride + c]);
+        }
+    }
+}
+
+template <size_t Stride> static glm::vec3 pointAt(const float* points, size_t i) {
+    return {points[i * Stride], points[i * Stride + 1], points[i * Stride + 2]};
+}
+
+// Ritter's step: the smallest sphere containing both the sphere and the point
+static void growSphere(Bounds& bounds, const glm::vec3& point) {
+    auto offset = point - bounds.center;
+    auto distance2 = glm::dot(offset, offset);
+    if (distance2 <= bounds.radius * bounds.radius) {
+        return;
+    }
+    auto distance = std::sqrt(distance2);
+    auto radius = (bounds.radius + distance) * 0.5f;
+    bounds.center += offset * ((radius - bounds.radius) / distance);
+    bounds.radius = radius;
+}
+
+// Moving the center rounds at the scale of its coordinates, which can leave points a few ulps outside
+static void padSphere(Bounds& bounds) {
+    auto center = glm::abs(bounds.center);
+    auto scale = bounds.radius + std::max({center.x, center.y, center.z});
+    bounds.radius += scale * 4 * std::numeric_limits<float>::epsilon();
+}
+
+template <size_t Stride> static Bounds computeBounds(const float* points, size_t count) {
+    Bounds bounds;
+    if (count == 0) {
+        return bounds;
+    }
+    reduceMinMax<Stride>(points, count, bounds.min, bounds.max);
+
+    // Points holding the box's faces, found by comparing against the reduced values
+    size_t lowest[3] = {0, 0, 0}, highest[3] = {0, 0, 0};
+    for (size_t i = count; i-- > 0;) {
+        for (int c = 0; c < 3; c++) {
+            lowest[c] = points[i * Stride + c] == bounds.min[c] ? i : lowest[c];
+            highest[c] = points[i * Stride + c] == bounds.max[c] ? i : highest[c];
+        }
+    }
+    float widest = -1.f;
+    for (int c = 0; c < 3; c++) {
+        auto a = pointAt<Stride>(points, lowest[c]), b = pointAt<Stride>(points, highest[c]);
+        auto distance = glm::length(b - a);
+        if (distance > widest) {
+            widest = distance;
+            bounds.center = (a + b) * 0.5f;
+            bounds.radius = distance * 0.5f;
+        }
+    }
+
+    auto box_center = (bounds.min + bounds.max) * 0.5f;
+    float box_radius2 = 0.f;
+    for (size_t i = 0; i < count; i++) {
+        auto point = pointAt<Stride>(points, i);
+        growSphere(bounds, point);
+        auto offset = point - box_center;
+        box_radius2 = std::max(box_radius2, glm::dot(offset, offset));
+    }
+    if (std::sqrt(box_radius2) < bounds.radius) {
+        bounds.center = box_center;
+        bounds.radius = std::sqrt(box_radius2);
+    }
+    padSphere(bounds);
+    return bounds;
+}
+
+template <size_t Stride> static void expandBounds(Bounds& bounds, const float* points, size_t count) {
+    if (bounds.isEmpty()) {
+        bounds = computeBounds<Stride>(points, count);
+        return;
+    }
+    if (count == 0) {
+        return;
+    }
+    reduceMinMax<Stride>(points, count, bounds.min, bounds.max);
+    for (size_t i = 0; i < count; i++) {
+        growSphere(bounds, pointAt<Stride>(points, i));
+    }
+    padSphere(bounds);
+}
+
+Bounds computeBounds(std::span<const glm::vec3> points) {
+    return computeBounds<3>(reinterpret_cast<const float*>(points.data()), points.size());
+}
+
+Bounds computeBounds(std::span<const glm::vec4> points) {
+    return computeBounds<4>(reinterpret_cast<const float*>(points.data()), points.size());
+}
+
+void expandBounds(Bounds& bounds, std::span<const glm::vec3> points) {
+    expandBounds<3>(bounds, reinterpret_cast<const float*>(points.data()), points.size());
+}
+
+void expandBounds(Bounds& bounds, std::span<const glm::vec4> points) {
+    expandBounds<4>(bounds, reinterpret_cast<const float*>(points.data()), points.size());
+}
+
+}; // namespace Engine
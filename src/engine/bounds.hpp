@@ -0,0 +1,29 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <limits>
+#include <span>
+
+namespace Engine {
+
+// Axis aligned box and bounding sphere of a set of points, both in the points' space
+struct Bounds {
+    glm::vec3 min{std::numeric_limits<float>::max()};
+    glm::vec3 max{std::numeric_limits<float>::lowest()};
+    glm::vec3 center{0.f};
+    float radius = -1.f; // negative while there are no points
+
+    bool isEmpty() const { return radius < 0.f; }
+};
+
+// The box is a SIMD min / max reduction. The sphere starts on the most distant pair of the extreme points along the
+// axes and grows to take in the points outside it (EPOS-6 followed by a Ritter pass); the sphere around the box
+// center is used instead when that is smaller. w of vec4 positions is ignored.
+Bounds computeBounds(std::span<const glm::vec3> points);
+Bounds computeBounds(std::span<const glm::vec4> points);
+
+// Grows bounds to contain points as well, without ever shrinking them
+void expandBounds(Bounds& bounds, std::span<const glm::vec3> points);
+void expandBounds(Bounds& bounds, std::span<const glm::vec4> points);
+
+}; // namespace Engine
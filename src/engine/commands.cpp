@@ -0,0 +1,78 @@
+#include "engine/commands.hpp"
+#include <algorithm>
+
+namespace Engine {
+
+static std::atomic<uint64_t> next_buffer_id{1};
+
+// Last buffer this thread recorded into, keyed by id rather than address so a new buffer at a reused address misses
+struct CachedThreadBuffer {
+    uint64_t buffer_id = 0;
+    void* buffer = nullptr;
+};
+static thread_local CachedThreadBuffer cached_buffer;
+
+CommandBuffer::CommandBuffer() : id{next_buffer_id.fetch_add(1, std::memory_order_relaxed)} {}
+
+CommandBuffer::~CommandBuffer() {
+    auto buffer = buffers.load();
+    while (buffer) {
+        auto next = buffer->next;
+        delete buffer;
+        buffer = next;
+    }
+}
+
+CommandBuffer::ThreadBuffer& CommandBuffer::local() {
+    if (cached_buffer.buffer_id == id) {
+        return *static_cast<ThreadBuffer*>(cached_buffer.buffer);
+    }
+
+    auto self = std::this_thread::get_id();
+    auto buffer = buffers.load(std::memory_order_acquire);
+    for (; buffer; buffer = buffer->next) {
+        if (buffer->owner == self) {
+            break;
+        }
+    }
+
+    // First command from this thread, push a new buffer onto the list
+    if (!buffer) {
+        buffer = new ThreadBuffer{self, {}, buffers.load(std::memory_order_relaxed)};
+        while (!buffers.compare_exchange_weak(buffer->next, buffer, std::memory_order_release,
+                                              std::memory_order_relaxed)) {
+        }
+    }
+
+    cached_buffer = {id, buffer};
+    return *buffer;
+}
+
+void CommandBuffer::record(std::move_only_function<void()> command) {
+    auto sequence_number = sequence.fetch_add(1, std::memory_order_relaxed);
+    local().commands.push_back({sequence_number, std::move(command)});
+}
+
+size_t CommandBuffer::apply() {
+    size_t applied = 0;
+
+    while (true) {
+        for (auto buffer = buffers.load(std::memory_order_acquire); buffer; buffer = buffer->next) {
+            std::ranges::move(buffer->commands, std::back_inserter(batch));
+            buffer->commands.clear();
+        }
+        if (batch.empty()) {
+            return applied;
+        }
+
+        std::ranges::sort(batch, {}, &Command::sequence);
+        for (auto& command : batch) {
+            command.apply();
+        }
+
+        applied += batch.size();
+        batch.clear();
+    }
+}
+
+}; // namespace Engine
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace Engine {
+
+// Records deferred operations from any number of threads and applies them later on one thread. Every thread appends
+// to its own buffer, so recording takes no lock; commands get a global sequence number and are applied in that order.
+class CommandBuffer {
+  public:
+    CommandBuffer();
+    ~CommandBuffer();
+
+    CommandBuffer(const CommandBuffer&) = delete;
+    CommandBuffer& operator=(const CommandBuffer&) = delete;
+
+    void record(std::move_only_function<void()> command);
+
+    // Applies everything recorded so far, including commands recorded by the commands themselves. Must not run
+    // concurrently with record. Returns the number of applied commands.
+    size_t apply();
+
+  private:
+    struct Command {
+        uint64_t sequence;
+        std::move_only_function<void()> apply;
+    };
+
+    struct ThreadBuffer {
+        std::thread::id owner;
+        std::vector<Command> commands;
+        ThreadBuffer* next;
+    };
+
+    const uint64_t id;
+    std::atomic<ThreadBuffer*> buffers{nullptr};
+    std::atomic<uint64_t> sequence{0};
+    std::vector<Command> batch;
+
+    ThreadBuffer& local();
+};
+
+}; // namespace Engine
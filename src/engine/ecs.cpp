@@ -0,0 +1,195 @@
+#include "engine/ecs.hpp"
+#include <deque>
+#include <mutex>
+
+namespace Engine {
+
+// Component registry, function-local so that components can be registered during static initialization
+struct ComponentRegistry {
+    std::mutex mutex;
+    std::deque<ComponentInfo> infos; // deque keeps references stable across registrations
+};
+
+static ComponentRegistry& componentRegistry() {
+    static ComponentRegistry registry;
+    return registry;
+}
+
+ComponentId registerComponent(const ComponentInfo& info) {
+    auto& registry = componentRegistry();
+    std::lock_guard lock{registry.mutex};
+    assert(registry.infos.size() < MAX_COMPONENTS && "Too many component types");
+    assert(info.alignment <= CHUNK_ALIGNMENT && "Component alignment exceeds chunk alignment");
+
+    registry.infos.push_back(info);
+    return static_cast<ComponentId>(registry.infos.size() - 1);
+}
+
+const ComponentInfo& getComponentInfo(ComponentId id) {
+    auto& registry = componentRegistry();
+    std::lock_guard lock{registry.mutex};
+    return registry.infos[id];
+}
+
+// Archetype implementation
+Archetype::Archetype(ComponentMask mask) : mask{mask} {
+    columns.fill(-1);
+
+    size_t row_size = sizeof(Entity);
+    size_t alignment_slack = 0;
+    for (ComponentId id = 0; id < MAX_COMPONENTS; id++) {
+        if (mask.test(id)) {
+            auto& info = getComponentInfo(id);
+            columns[id] = static_cast<int>(component_ids.size());
+            component_ids.push_back(id);
+            infos.push_back(info);
+            row_size += info.size;
+            alignment_slack += info.alignment;
+        }
+    }
+
+    capacity = (CHUNK_SIZE - alignment_slack) / row_size;
+    assert(capacity > 0 && "Components do not fit in a chunk");
+
+    size_t offset = capacity * sizeof(Entity);
+    for (auto& info : infos) {
+        offset = (offset + info.alignment - 1) / info.alignment * info.alignment;
+        offsets.push_back(offset);
+        offset += capacity * info.size;
+    }
+    assert(offset <= CHUNK_SIZE);
+}
+
+Archetype::~Archetype() {
+    for (size_t column = 0; column < infos.size(); column++) {
+        for (size_t row = 0; row < count; row++) {
+            infos[column].destroy(get(static_cast<int>(column), row));
+        }
+    }
+}
+
+size_t Archetype::allocate() {
+    if (count == chunks.size() * capacity) {
+        chunks.push_back(std::make_unique<Chunk>());
+    }
+    return count++;
+}
+
+Entity Archetype::swapRemove(size_t row) {
+    auto last = count - 1;
+    Entity moved;
+
+    if (row != last) {
+        for (size_t column = 0; column < infos.size(); column++) {
+            auto c = static_cast<int>(column);
+            infos[column].move(get(c, row), get(c, last));
+        }
+        moved = entity(row) = entity(last);
+    }
+
+    count--;
+    // Keep one spare chunk around so an entity bouncing on a chunk boundary does not allocate every time
+    if (chunks.size() > 1 && count + 2 * capacity <= chunks.size() * capacity) {
+        chunks.pop_back();
+    }
+    return moved;
+}
+
+// World implementation
+World::World() { empty_archetype = &getArchetype({}); }
+
+World::~World() = default;
+
+Entity World::create() {
+    assert(iterating == 0 && "Cannot create entities while iterating");
+
+    uint32_t index;
+    if (!free_indices.empty()) {
+        index = free_indices.back();
+        free_indices.pop_back();
+    } else {
+        index = static_cast<uint32_t>(records.size());
+        records.push_back({nullptr, 0, 0});
+    }
+
+    Entity entity{index, records[index].generation};
+    auto row = empty_archetype->allocate();
+    empty_archetype->entity(row) = entity;
+    records[index].archetype = empty_archetype;
+    records[index].row = row;
+
+    return entity;
+}
+
+void World::destroy(Entity entity) {
+    assert(iterating == 0 && "Cannot destroy entities while iterating");
+    if (!alive(entity)) {
+        return;
+    }
+
+    auto& record = records[entity.index];
+    auto& archetype = *record.archetype;
+    for (auto id : archetype.components()) {
+        auto column = archetype.column(id);
+        archetype.info(column).destroy(archetype.get(column, record.row));
+    }
+
+    if (auto moved = archetype.swapRemove(record.row)) {
+        records[moved.index].row = record.row;
+    }
+
+    record.archetype = nullptr;
+    record.generation++;
+    free_indices.push_back(entity.index);
+}
+
+bool World::alive(Entity entity) const {
+    return entity && entity.index < records.size() && records[entity.index].generation == entity.generation &&
+           records[entity.index].archetype != nullptr;
+}
+
+void World::runSystems(float deltaTime) {
+    for (auto& system : systems) {
+        system(*this, deltaTime);
+    }
+}
+
+Archetype& World::getArchetype(ComponentMask mask) {
+    auto it = by_mask.find(mask);
+    if (it != by_mask.end()) {
+        return *it->second;
+    }
+
+    archetypes.push_back(std::make_unique<Archetype>(mask));
+    by_mask[mask] = archetypes.back().get();
+    return *archetypes.back();
+}
+
+void World::move(Entity entity, Archetype& to) {
+    assert(iterating == 0 && "Cannot change components while iterating");
+
+    auto& record = records[entity.index];
+    auto& from = *record.archetype;
+    auto row = to.allocate();
+    to.entity(row) = entity;
+
+    // Components present in both archetypes move across, the rest is destroyed
+    for (auto id : from.components()) {
+        auto& info = from.info(from.column(id));
+        auto src = from.get(from.column(id), record.row);
+        if (auto column = to.column(id); column >= 0) {
+            info.move(to.get(column, row), src);
+        } else {
+            info.destroy(src);
+        }
+    }
+
+    if (auto moved = from.swapRemove(record.row)) {
+        records[moved.index].row = record.row;
+    }
+
+    record.archetype = &to;
+    record.row = row;
+}
+
+}; // namespace Engine
@@ -0,0 +1,235 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Engine {
+
+constexpr size_t MAX_COMPONENTS = 64;
+constexpr size_t CHUNK_SIZE = 16 * 1024;
+constexpr size_t CHUNK_ALIGNMENT = 64;
+
+using ComponentId = uint32_t;
+using ComponentMask = std::bitset<MAX_COMPONENTS>;
+
+struct Entity {
+    uint32_t index = std::numeric_limits<uint32_t>::max();
+    uint32_t generation = 0;
+
+    explicit operator bool() const { return index != std::numeric_limits<uint32_t>::max(); }
+    bool operator==(const Entity& other) const = default;
+};
+
+struct ComponentInfo {
+    size_t size;
+    size_t alignment;
+    void (*move)(void* dst, void* src); // move-constructs dst from src and destroys src
+    void (*destroy)(void* ptr);
+};
+
+ComponentId registerComponent(const ComponentInfo& info);
+const ComponentInfo& getComponentInfo(ComponentId id);
+
+// Ids are handed out on first use of a component type
+template <typename T> ComponentId componentId() {
+    static const ComponentId id = registerComponent({
+        sizeof(T),
+        alignof(T),
+        [](void* dst, void* src) {
+            new (dst) T(std::move(*static_cast<T*>(src)));
+            static_cast<T*>(src)->~T();
+        },
+        [](void* ptr) { static_cast<T*>(ptr)->~T(); },
+    });
+    return id;
+}
+
+// All entities with exactly the same set of components. Rows are packed densely into fixed size chunks, and inside a
+// chunk every component has its own contiguous array (entities first, then one array per component).
+class Archetype {
+  public:
+    explicit Archetype(ComponentMask mask);
+    ~Archetype();
+
+    Archetype(const Archetype&) = delete;
+    Archetype& operator=(const Archetype&) = delete;
+
+    const ComponentMask mask;
+
+    size_t size() const { return count; }
+    size_t chunkCount() const { return chunks.size(); }
+    size_t chunkSize(size_t chunk) const { return std::min(capacity, count - chunk * capacity); }
+
+    // Column of a component in this archetype, -1 when absent
+    int column(ComponentId id) const { return columns[id]; }
+
+    Entity* entities(size_t chunk) { return reinterpret_cast<Entity*>(chunks[chunk]->data); }
+    void* columnData(size_t chunk, int column) { return chunks[chunk]->data + offsets[column]; }
+
+    Entity& entity(size_t row) { return entities(row / capacity)[row % capacity]; }
+    void* get(int column, size_t row) {
+        return static_cast<std::byte*>(columnData(row / capacity, column)) + (row % capacity) * infos[column].size;
+    }
+
+    const std::vector<ComponentId>& components() const { return component_ids; }
+    const ComponentInfo& info(int column) const { return infos[column]; }
+
+    size_t allocate();
+    // Fills the row (whose components must already be moved out or destroyed) with the last row. Returns the entity
+    // that moved into the row, or an invalid entity if the row was the last one.
+    Entity swapRemove(size_t row);
+
+  private:
+    struct alignas(CHUNK_ALIGNMENT) Chunk {
+        std::byte data[CHUNK_SIZE];
+    };
+
+    std::vector<ComponentId> component_ids;
+    std::vector<ComponentInfo> infos;
+    std::array<int, MAX_COMPONENTS> columns;
+    std::vector<size_t> offsets;
+    size_t capacity;
+
+    std::vector<std::unique_ptr<Chunk>> chunks;
+    size_t count = 0;
+};
+
+class World {
+  public:
+    World();
+    ~World();
+
+    World(const World&) = delete;
+    World& operator=(const World&) = delete;
+
+    Entity create();
+    void destroy(Entity entity);
+    bool alive(Entity entity) const;
+    size_t size() const { return records.size() - free_indices.size(); }
+
+    template <typename T> T& add(Entity entity, T component = {}) {
+        assert(alive(entity));
+        auto id = componentId<T>();
+        auto& record = records[entity.index];
+
+        if (auto column = record.archetype->column(id); column >= 0) {
+            auto& existing = *static_cast<T*>(record.archetype->get(column, record.row));
+            existing = std::move(component);
+            return existing;
+        }
+
+        auto mask = record.archetype->mask;
+        mask.set(id);
+        move(entity, getArchetype(mask));
+
+        auto ptr = record.archetype->get(record.archetype->column(id), record.row);
+        return *new (ptr) T(std::move(component));
+    }
+
+    template <typename T> void remove(Entity entity) {
+        assert(alive(entity));
+        auto id = componentId<T>();
+        auto& record = records[entity.index];
+        if (record.archetype->column(id) < 0) {
+            return;
+        }
+
+        auto mask = record.archetype->mask;
+        mask.reset(id);
+        move(entity, getArchetype(mask));
+    }
+
+    template <typename T> T* get(Entity entity) { return static_cast<T*>(get(entity, componentId<T>())); }
+
+    // Type erased get, for code that only knows the component id
+    void* get(Entity entity, ComponentId id) {
+        if (!alive(entity)) {
+            return nullptr;
+        }
+        auto& record = records[entity.index];
+        auto column = record.archetype->column(id);
+        return column < 0 ? nullptr : record.archetype->get(column, record.row);
+    }
+
+    template <typename T> bool has(Entity entity) { return get<T>(entity) != nullptr; }
+
+    // Calls fn(Ts&...) or fn(Entity, Ts&...) for every entity that has all of Ts. Iterates chunk by chunk over the
+    // component arrays. Entities must not be created, destroyed or change components from inside fn.
+    template <typename... Ts, typename F> void each(F&& fn) {
+        ComponentMask required;
+        (required.set(componentId<Ts>()), ...);
+
+        iterating++;
+        for (auto& archetype : archetypes) {
+            if ((archetype->mask & required) == required && archetype->size() > 0) {
+                eachInArchetype<Ts...>(*archetype, fn, std::index_sequence_for<Ts...>{});
+            }
+        }
+        iterating--;
+    }
+
+    // Registers a system that runs fn(deltaTime, Ts&...) over every matching entity on each runSystems call, in
+    // registration order.
+    template <typename... Ts, typename F> void addSystem(F fn) {
+        systems.push_back([fn = std::move(fn)](World& world, float deltaTime) mutable {
+            world.each<Ts...>([&](Ts&... components) { fn(deltaTime, components...); });
+        });
+    }
+
+    void runSystems(float deltaTime);
+
+  private:
+    struct Record {
+        Archetype* archetype;
+        size_t row;
+        uint32_t generation;
+    };
+
+    std::vector<Record> records;
+    std::vector<uint32_t> free_indices;
+
+    std::vector<std::unique_ptr<Archetype>> archetypes;
+    std::unordered_map<ComponentMask, Archetype*> by_mask;
+    Archetype* empty_archetype;
+
+    std::vector<std::function<void(World&, float)>> systems;
+    int iterating = 0;
+
+    Archetype& getArchetype(ComponentMask mask);
+    void move(Entity entity, Archetype& to);
+
+    template <typename... Ts, typename F, size_t... Is>
+    void eachInArchetype(Archetype& archetype, F& fn, std::index_sequence<Is...>) {
+        std::array<int, sizeof...(Ts)> columns{archetype.column(componentId<Ts>())...};
+
+        for (size_t chunk = 0; chunk < archetype.chunkCount(); chunk++) {
+            auto count = archetype.chunkSize(chunk);
+            auto arrays = std::make_tuple(static_cast<Ts*>(archetype.columnData(chunk, columns[Is]))...);
+
+            if constexpr (std::is_invocable_v<F&, Entity, Ts&...>) {
+                auto entities = archetype.entities(chunk);
+                for (size_t i = 0; i < count; i++) {
+                    fn(entities[i], std::get<Is>(arrays)[i]...);
+                }
+            } else {
+                for (size_t i = 0; i < count; i++) {
+                    fn(std::get<Is>(arrays)[i]...);
+                }
+            }
+        }
+    }
+};
+
+}; // namespace Engine
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "engine/hash.hpp"
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace Engine {
+
+class Node;
+
+using EventId = uint64_t;
+using ListenerId = uint32_t;
+
+constexpr EventId hashEventName(std::string_view name) { return hashFnv1a(name); }
+
+// Compile-time id of an event type, hashed from the (compiler generated) name of this instantiation
+template <typename E> constexpr EventId eventId() { return hashEventName(__PRETTY_FUNCTION__); }
+
+struct EventContext {
+    Node* target;  // node the event was routed to
+    Node* current; // node whose listeners are running, walks up the ancestors while the event bubbles
+    bool stopped = false;
+
+    void stopPropagation() { stopped = true; }
+};
+
+struct EventListener {
+    EventId event;
+    ListenerId id;
+    std::function<void(const void*, EventContext&)> callback;
+};
+
+template <typename E, typename F> std::function<void(const void*, EventContext&)> makeEventCallback(F&& callback) {
+    if constexpr (std::is_invocable_v<F, const E&, EventContext&>) {
+        return [cb = std::forward<F>(callback)](const void* payload, EventContext& context) {
+            cb(*static_cast<const E*>(payload), context);
+        };
+    } else {
+        static_assert(std::is_invocable_v<F, const E&>, "callback must accept (const E&) or (const E&, EventContext&)");
+        return [cb = std::forward<F>(callback)](const void* payload, EventContext&) {
+            cb(*static_cast<const E*>(payload));
+        };
+    }
+}
+
+// Events posted during a frame, delivered together in posting order when dispatch() is called. Payloads are stored
+// per event type in deques, which keeps references stable while listeners post more events during dispatch.
+class EventQueue {
+  public:
+    template <typename E> void post(Node* target, E event) {
+        std::lock_guard lock{mutex};
+        auto& channel = getChannel<E>();
+        entries.push_back({target, eventId<E>(), &channel, channel.size()});
+        channel.events.push_back(std::move(event));
+    }
+
+    // Drops every queued event whose target satisfies pred
+    template <typename Pred> void cancel(Pred&& pred) {
+        std::lock_guard lock{mutex};
+        for (auto& entry : entries) {
+            if (entry.target && pred(entry.target)) {
+                entry.target = nullptr;
+            }
+        }
+    }
+
+    // Calls deliver(target, id, payload) for every queued event. Events posted while dispatching are delivered in
+    // the same call.
+    template <typename Deliver> void dispatch(Deliver&& deliver) {
+        for (size_t i = 0;; i++) {
+            Entry entry;
+            const void* payload;
+            {
+                std::lock_guard lock{mutex};
+                if (i >= entries.size()) {
+                    entries.clear();
+                    for (auto& channel : channels) {
+                        channel->clear();
+                    }
+                    return;
+                }
+                entry = entries[i];
+                payload = entry.channel->get(entry.index);
+            }
+            if (entry.target) {
+                deliver(entry.target, entry.id, payload);
+            }
+        }
+    }
+
+    bool empty() const {
+        std::lock_guard lock{mutex};
+        return entries.empty();
+    }
+
+  private:
+    struct Channel {
+        virtual ~Channel() = default;
+        virtual const void* get(size_t index) const = 0;
+        virtual size_t size() const = 0;
+        virtual void clear() = 0;
+    };
+
+    template <typename E> struct TypedChannel : Channel {
+        std::deque<E> events;
+        const void* get(size_t index) const override { return &events[index]; }
+        size_t size() const override { return events.size(); }
+        void clear() override { events.clear(); }
+    };
+
+    struct Entry {
+        Node* target;
+        EventId id;
+        Channel* channel;
+        size_t index;
+    };
+
+    mutable std::mutex mutex;
+    std::vector<Entry> entries;
+    std::vector<std::unique_ptr<Channel>> channels;
+    std::vector<EventId> channel_ids;
+
+    template <typename E> TypedChannel<E>& getChannel() {
+        for (size_t i = 0; i < channel_ids.size(); i++) {
+            if (channel_ids[i] == eventId<E>()) {
+                return static_cast<TypedChannel<E>&>(*channels[i]);
+            }
+        }
+        channel_ids.push_back(eventId<E>());
+        channels.push_back(std::make_unique<TypedChannel<E>>());
+        return static_cast<TypedChannel<E>&>(*channels.back());
+    }
+};
+
+}; // namespace Engine
@@ -0,0 +1,264 @@
+#include "engine/geometry_pool.hpp"
+#include <algorithm>
+
+namespace Engine {
+
+// Range allocation
+RangeAllocator::RangeAllocator(size_t capacity) : capacity{capacity} {
+    if (capacity > 0) {
+        insertBlock(0, capacity);
+    }
+}
+
+std::optional<size_t> RangeAllocator::allocate(size_t size) {
+    auto best = by_size.lower_bound({size, 0});
+    if (best == by_size.end()) {
+        return std::nullopt;
+    }
+
+    auto [block_size, offset] = *best;
+    eraseBlock(by_offset.find(offset));
+    if (block_size > size) {
+        insertBlock(offset + size, block_size - size);
+    }
+    return offset;
+}
+
+void RangeAllocator::free(size_t offset, size_t size) {
+    auto next = by_offset.lower_bound(offset);
+    assert((next == by_offset.end() || next->first >= offset + size) && "Freeing a range that is already free");
+
+    if (next != by_offset.begin()) {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset) {
+            offset = previous->first;
+            size += previous->second;
+            eraseBlock(previous);
+        }
+    }
+    if (next != by_offset.end() && next->first == offset + size) {
+        size += next->second;
+        eraseBlock(next);
+    }
+    insertBlock(offset, size);
+}
+
+void RangeAllocator::reset(size_t used, size_t capacity) {
+    this->capacity = capacity;
+    by_offset.clear();
+    by_size.clear();
+    free_size = 0;
+    if (capacity > used) {
+        insertBlock(used, capacity - used);
+    }
+}
+
+void RangeAllocator::insertBlock(size_t offset, size_t size) {
+    by_offset.emplace(offset, size);
+    by_size.emplace(size, offset);
+    free_size += size;
+}
+
+void RangeAllocator::eraseBlock(std::map<size_t, size_t>::iterator block) {
+    by_size.erase({block->second, block->first});
+    free_size -= block->second;
+    by_offset.erase(block);
+}
+
+// Geometry pool
+GeometryPool::GeometryPool(std::span<const VertexAttributeFormat> formats, size_t stride, size_t vertex_capacity,
+                           size_t index_capacity)
+    : vao{GpuVertexArray::create()}, vbo{GpuBuffer::create()}, ebo{GpuBuffer::create()},
+      formats(formats.begin(), formats.end()), stride{stride}, vertices{vertex_capacity}, indices{index_capacity} {
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, vertex_capacity * stride, nullptr, GL_STATIC_DRAW);
+    setVertexAttributes(this->formats, stride);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_capacity * sizeof(uint), nullptr, GL_STATIC_DRAW);
+    glBindVertexArray(0);
+}
+
+GeometryId GeometryPool::add(std::span<const std::byte> vertex_data, std::span<const uint> index_data) {
+    assert(vertex_data.size() % stride == 0 && "Vertex data is not a whole number of vertices");
+    auto vertex_count = vertex_data.size() / stride;
+    auto index_count = index_data.size();
+    assert(vertex_count > 0 && index_count > 0);
+
+    auto first_vertex = vertices.allocate(vertex_count);
+    auto first_index = indices.allocate(index_count);
+    if (!first_vertex || !first_index) {
+        if (first_vertex) {
+            vertices.free(*first_vertex, vertex_count);
+        }
+        if (first_index) {
+            indices.free(*first_index, index_count);
+        }
+
+        // Compacting is enough while the total free space fits the mesh, otherwise the buffers double until it does
+        auto vertex_capacity = std::max<size_t>(vertices.getCapacity(), 1);
+        while (vertex_capacity - (vertices.getCapacity() - vertices.getFreeSize()) < vertex_count) {
+            vertex_capacity *= 2;
+        }
+        auto index_capacity = std::max<size_t>(indices.getCapacity(), 1);
+        while (index_capacity - (indices.getCapacity() - indices.getFreeSize()) < index_count) {
+            index_capacity *= 2;
+        }
+        relocate(vertex_capacity, index_capacity);
+
+        first_vertex = vertices.allocate(vertex_count);
+        first_index = indices.allocate(index_count);
+        assert(first_vertex && first_index);
+    }
+
+    // Uploads go through the copy target so that no VAO's element buffer binding is touched
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, *first_vertex * stride, vertex_data.size(), vertex_data.data());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ebo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, *first_index * sizeof(uint), index_count * sizeof(uint), index_data.data());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    GeometryId id;
+    if (free_slots.empty()) {
+        id = static_cast<GeometryId>(slots.size());
+        slots.emplace_back();
+    } else {
+        id = free_slots.back();
+        free_slots.pop_back();
+    }
+    slots[id] = {{static_cast<uint>(*first_vertex), static_cast<uint>(vertex_count), static_cast<uint>(*first_index),
+                  static_cast<uint>(index_count)},
+                 true};
+    live++;
+    return id;
+}
+
+void GeometryPool::remove(GeometryId id) {
+    assert(id < slots.size() && slots[id].live && "Removing a mesh that is not in the pool");
+    auto &range = slots[id].range;
+    vertices.free(range.first_vertex, range.vertex_count);
+    indices.free(range.first_index, range.index_count);
+    slots[id].live = false;
+    free_slots.push_back(id);
+    live--;
+
+    // The slot can be handed out again before the next flush
+    std::erase(queued, id);
+}
+
+const GeometryRange &GeometryPool::getRange(GeometryId id) const {
+    assert(id < slots.size() && slots[id].live);
+    return slots[id].range;
+}
+
+void GeometryPool::defragment() { relocate(vertices.getCapacity(), indices.getCapacity()); }
+
+// Copies the live meshes into new buffers of the given capacity, packed in their current order. The data never
+// leaves the GPU.
+void GeometryPool::relocate(size_t vertex_capacity, size_t index_capacity) {
+    auto new_vbo = GpuBuffer::create();
+    auto new_ebo = GpuBuffer::create();
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, new_vbo);
+    glBufferData(GL_COPY_WRITE_BUFFER, vertex_capacity * stride, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, new_ebo);
+    glBufferData(GL_COPY_WRITE_BUFFER, index_capacity * sizeof(uint), nullptr, GL_STATIC_DRAW);
+
+    std::vector<GeometryId> order;
+    order.reserve(live);
+    for (GeometryId id = 0; id < slots.size(); id++) {
+        if (slots[id].live) {
+            order.push_back(id);
+        }
+    }
+
+    // Meshes that already follow each other are copied as one run
+    struct Run {
+        size_t from, to, size;
+    };
+    auto pack = [&](GLuint from, GLuint to, size_t unit, auto first, auto count) {
+        glBindBuffer(GL_COPY_READ_BUFFER, from);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, to);
+        std::ranges::sort(order, {}, [&](GeometryId id) { return slots[id].range.*first; });
+
+        size_t end = 0;
+        Run run{0, 0, 0};
+        auto copy = [&]() {
+            if (run.size > 0) {
+                glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, run.from * unit, run.to * unit,
+                                    run.size * unit);
+            }
+        };
+        for (auto id : order) {
+            auto &range = slots[id].range;
+            if (range.*first != run.from + run.size) {
+                copy();
+                run = {range.*first, end, 0};
+            }
+            run.size += range.*count;
+            range.*first = static_cast<uint>(end);
+            end += range.*count;
+        }
+        copy();
+        return end;
+    };
+    auto vertex_end = pack(vbo, new_vbo, stride, &GeometryRange::first_vertex, &GeometryRange::vertex_count);
+    auto index_end = pack(ebo, new_ebo, sizeof(uint), &GeometryRange::first_index, &GeometryRange::index_count);
+
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    // The old buffers are only deleted once the draws still reading them have finished
+    vbo = std::move(new_vbo);
+    ebo = std::move(new_ebo);
+
+    // Attribute pointers hold on to the buffer they were set with
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    setVertexAttributes(formats, stride);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    glBindVertexArray(0);
+
+    vertices.reset(vertex_end, vertex_capacity);
+    indices.reset(index_end, index_capacity);
+    relocations++;
+}
+
+void GeometryPool::queueDraw(GeometryId id) {
+    assert(id < slots.size() && slots[id].live && "Drawing a mesh that is not in the pool");
+    queued.push_back(id);
+}
+
+void GeometryPool::flush(GLenum primitive_type) {
+    // Ranges are read only now, adds between queueDraw and flush may have moved the meshes
+    for (auto id : queued) {
+        auto &range = slots[id].range;
+        draw_counts.push_back(static_cast<GLsizei>(range.index_count));
+        draw_offsets.push_back(reinterpret_cast<const void *>(range.first_index * sizeof(uint)));
+        draw_base_vertices.push_back(static_cast<GLint>(range.first_vertex));
+    }
+
+    if (!draw_counts.empty()) {
+        glBindVertexArray(vao);
+        glMultiDrawElementsBaseVertex(primitive_type, draw_counts.data(), GL_UNSIGNED_INT, draw_offsets.data(),
+                                      static_cast<GLsizei>(draw_counts.size()), draw_base_vertices.data());
+        glBindVertexArray(0);
+    }
+
+    queued.clear();
+    draw_counts.clear();
+    draw_offsets.clear();
+    draw_base_vertices.clear();
+}
+
+GeometryPool::Stats GeometryPool::getStats() const {
+    return {
+        (vertices.getCapacity() - vertices.getFreeSize()) * stride,
+        vertices.getCapacity() * stride,
+        (indices.getCapacity() - indices.getFreeSize()) * sizeof(uint),
+        indices.getCapacity() * sizeof(uint),
+        vertices.getLargestFree(),
+        relocations,
+    };
+}
+
+}; // namespace Engine
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "engine/gpu_resource.hpp"
+#include "engine/vertex_layout.hpp"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <glad/glad.h>
+#include <map>
+#include <optional>
+#include <set>
+#include <span>
+#include <sys/types.h>
+#include <vector>
+
+namespace Engine {
+
+// Hands out ranges of a linear space of capacity units. Free blocks are coalesced with their neighbours and
+// allocations take the smallest block they fit in.
+class RangeAllocator {
+  public:
+    explicit RangeAllocator(size_t capacity = 0);
+
+    std::optional<size_t> allocate(size_t size);
+    void free(size_t offset, size_t size);
+
+    // Marks [0, used) as allocated and the rest up to capacity as one free block, after the owner compacted its data
+    void reset(size_t used, size_t capacity);
+
+    size_t getCapacity() const { return capacity; }
+    size_t getFreeSize() const { return free_size; }
+    size_t getLargestFree() const { return by_size.empty() ? 0 : by_size.rbegin()->first; }
+
+  private:
+    size_t capacity;
+    size_t free_size = 0;
+    std::map<size_t, size_t> by_offset;         // offset -> size of every free block
+    std::set<std::pair<size_t, size_t>> by_size; // (size, offset) of every free block
+
+    void insertBlock(size_t offset, size_t size);
+    void eraseBlock(std::map<size_t, size_t>::iterator block);
+};
+
+using GeometryId = uint32_t;
+
+// Where a mesh's vertices and indices live in a GeometryPool, in vertices and indices
+struct GeometryRange {
+    uint first_vertex;
+    uint vertex_count;
+    uint first_index;
+    uint index_count;
+};
+
+// Vertices and 32 bit indices of many meshes with one layout, sub-allocated from a single vertex and element buffer
+// behind one VAO. Indices stay relative to their mesh and are drawn from its first vertex, so meshes can be moved
+// around the buffers without touching them. Queued draws are submitted together with glMultiDrawElementsBaseVertex.
+class GeometryPool {
+  public:
+    GeometryPool(std::span<const VertexAttributeFormat> formats, size_t stride, size_t vertex_capacity = 1 << 16,
+                 size_t index_capacity = 1 << 18);
+
+    GeometryPool(const GeometryPool &) = delete;
+    GeometryPool &operator=(const GeometryPool &) = delete;
+    GeometryPool(GeometryPool &&) noexcept = default;
+    GeometryPool &operator=(GeometryPool &&) noexcept = default;
+
+    // Copies in already interleaved vertices. When no free block is large enough the buffers are compacted, and
+    // grown if that does not help either.
+    GeometryId add(std::span<const std::byte> vertex_data, std::span<const uint> index_data);
+
+    // One stream per attribute, interleaved with the compile-time layout of the attribute types
+    template <typename... Attributes>
+    GeometryId add(size_t vertex_count, std::span<const uint> index_data, const Attributes *...streams) {
+        using Layout = VertexLayout<Attributes...>;
+        assert(Layout::stride == stride && "Attributes do not match the pool's layout");
+        std::vector<std::byte> vertex_data(vertex_count * Layout::stride);
+        Layout::interleave(vertex_data.data(), vertex_count, streams...);
+        return add(vertex_data, index_data);
+    }
+
+    void remove(GeometryId id);
+    const GeometryRange &getRange(GeometryId id) const;
+    size_t size() const { return live; }
+
+    // Moves every live mesh to the front of the buffers, leaving all free space in one block at the end
+    void defragment();
+
+    // Draws are collected and then issued in a single call, all sharing the currently bound program and uniforms.
+    // Where each mesh lives is looked up at flush, so meshes can be added or removed in between.
+    void queueDraw(GeometryId id);
+    void flush(GLenum primitive_type = GL_TRIANGLES);
+
+    struct Stats {
+        size_t vertex_bytes_used, vertex_bytes_capacity;
+        size_t index_bytes_used, index_bytes_capacity;
+        size_t largest_free_vertices; // vertices the largest free block can still take without compacting
+        size_t relocations;           // compactions, including the ones that grew the buffers
+    };
+    Stats getStats() const;
+
+  private:
+    struct Slot {
+        GeometryRange range;
+        bool live = false;
+    };
+
+    GpuVertexArray vao;
+    GpuBuffer vbo, ebo;
+    std::vector<VertexAttributeFormat> formats;
+    size_t stride;
+
+    RangeAllocator vertices;
+    RangeAllocator indices;
+    std::vector<Slot> slots;
+    std::vector<GeometryId> free_slots;
+    size_t live = 0;
+    size_t relocations = 0;
+
+    std::vector<GeometryId> queued;
+    std::vector<GLsizei> draw_counts;
+    std::vector<const void *> draw_offsets;
+    std::vector<GLint> draw_base_vertices;
+
+    void relocate(size_t vertex_capacity, size_t index_capacity);
+};
+
+}; // namespace Engine
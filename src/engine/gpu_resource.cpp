@@ -0,0 +1,90 @@
+#include "engine/gpu_resource.hpp"
+
+namespace Engine {
+
+GLuint createGpuObject(GpuResourceType type) {
+    GLuint name = 0;
+    switch (type) {
+    case GpuResourceType::Buffer:
+        glGenBuffers(1, &name);
+        break;
+    case GpuResourceType::VertexArray:
+        glGenVertexArrays(1, &name);
+        break;
+    case GpuResourceType::Texture:
+        glGenTextures(1, &name);
+        break;
+    case GpuResourceType::Program:
+        name = glCreateProgram();
+        break;
+    }
+    return name;
+}
+
+void GpuDeletionQueue::push(GpuResourceType type, GLuint name) {
+    std::lock_guard lock{mutex};
+    current.push_back({type, name});
+}
+
+void GpuDeletionQueue::endFrame() {
+    std::lock_guard lock{mutex};
+    if (!current.empty()) {
+        batches.push_back({std::move(current), GpuSync{glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0)}});
+        current.clear();
+    }
+
+    // Fences signal in submission order, so the first unfinished batch ends the search
+    while (!batches.empty()) {
+        auto status = glClientWaitSync(batches.front().fence.get(), 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            break;
+        }
+        for (auto& entry : batches.front().entries) {
+            destroy(entry);
+        }
+        batches.pop_front();
+    }
+}
+
+void GpuDeletionQueue::flush() {
+    std::lock_guard lock{mutex};
+    glFinish();
+    for (auto& batch : batches) {
+        for (auto& entry : batch.entries) {
+            destroy(entry);
+        }
+    }
+    batches.clear();
+    for (auto& entry : current) {
+        destroy(entry);
+    }
+    current.clear();
+}
+
+size_t GpuDeletionQueue::getPendingCount() const {
+    std::lock_guard lock{mutex};
+    auto count = current.size();
+    for (auto& batch : batches) {
+        count += batch.entries.size();
+    }
+    return count;
+}
+
+void GpuDeletionQueue::destroy(const Entry& entry) {
+    switch (entry.type) {
+    case GpuResourceType::Buffer:
+        glDeleteBuffers(1, &entry.name);
+        break;
+    case GpuResourceType::VertexArray:
+        glDeleteVertexArrays(1, &entry.name);
+        break;
+    case GpuResourceType::Texture:
+        glDeleteTextures(1, &entry.name);
+        break;
+    case GpuResourceType::Program:
+        glDeleteProgram(entry.name);
+        break;
+    }
+}
+
+}; // namespace Engine
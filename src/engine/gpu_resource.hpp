@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <glad/glad.h>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Engine {
+
+enum class GpuResourceType {
+    Buffer,
+    VertexArray,
+    Texture,
+    Program,
+};
+
+// Owns a fence and deletes it with the owner
+struct GpuSyncDeleter {
+    void operator()(GLsync sync) const { glDeleteSync(sync); }
+};
+using GpuSync = std::unique_ptr<std::remove_pointer_t<GLsync>, GpuSyncDeleter>;
+
+// GL objects dropped by their owners are only deleted once the GPU finished every command issued before they were
+// dropped, so releasing a resource that is still in flight never makes the driver wait. Everything dropped during a
+// frame is fenced as one batch by endFrame.
+class GpuDeletionQueue {
+  public:
+    // Deliberately leaked, like Pool, so that resources may still be released during static destruction
+    static GpuDeletionQueue& instance() {
+        static auto queue = new GpuDeletionQueue();
+        return *queue;
+    }
+
+    void push(GpuResourceType type, GLuint name);
+
+    // Fences the objects dropped since the last call, and deletes the batches whose fences have signaled. Never
+    // waits on the GPU. Call once per frame, after the frame's draws are issued.
+    void endFrame();
+
+    // Deletes everything right away, after waiting for the GPU. For shutdown, while the context is still current.
+    void flush();
+
+    size_t getPendingCount() const;
+
+  private:
+    struct Entry {
+        GpuResourceType type;
+        GLuint name;
+    };
+
+    struct Batch {
+        std::vector<Entry> entries;
+        GpuSync fence;
+    };
+
+    mutable std::mutex mutex;
+    std::vector<Entry> current;
+    std::deque<Batch> batches;
+
+    GpuDeletionQueue() = default;
+
+    static void destroy(const Entry& entry);
+};
+
+GLuint createGpuObject(GpuResourceType type);
+
+// Move-only owner of one GL object name, handing it to the GpuDeletionQueue when dropped. Converts to the name, so it
+// can be passed to GL calls directly.
+template <GpuResourceType Type> class GpuHandle {
+  public:
+    GpuHandle() = default;
+    explicit GpuHandle(GLuint name) : name{name} {}
+    ~GpuHandle() { reset(); }
+
+    GpuHandle(const GpuHandle&) = delete;
+    GpuHandle& operator=(const GpuHandle&) = delete;
+
+    GpuHandle(GpuHandle&& other) noexcept : name{std::exchange(other.name, 0)} {}
+    GpuHandle& operator=(GpuHandle&& other) noexcept {
+        if (this != &other) {
+            reset(std::exchange(other.name, 0));
+        }
+        return *this;
+    }
+
+    static GpuHandle create() { return GpuHandle{createGpuObject(Type)}; }
+
+    // Drops the current object, if any, and takes over name
+    void reset(GLuint name = 0) {
+        if (this->name) {
+            GpuDeletionQueue::instance().push(Type, this->name);
+        }
+        this->name = name;
+    }
+
+    GLuint get() const { return name; }
+    operator GLuint() const { return name; }
+    explicit operator bool() const { return name != 0; }
+
+  private:
+    GLuint name = 0;
+};
+
+using GpuBuffer = GpuHandle<GpuResourceType::Buffer>;
+using GpuVertexArray = GpuHandle<GpuResourceType::VertexArray>;
+using GpuTexture = GpuHandle<GpuResourceType::Texture>;
+using GpuProgram = GpuHandle<GpuResourceType::Program>;
+
+}; // namespace Engine
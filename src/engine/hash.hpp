@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace Engine {
+
+constexpr uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ull;
+constexpr uint64_t FNV_PRIME = 0x100000001b3ull;
+
+// 64 bit FNV-1a of data. Passing the hash of a prefix as hash continues it, so strings can be hashed piece by piece.
+constexpr uint64_t hashFnv1a(std::string_view data, uint64_t hash = FNV_OFFSET_BASIS) {
+    for (char c : data) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+}; // namespace Engine
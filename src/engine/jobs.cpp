@@ -0,0 +1,189 @@
+#include "engine/jobs.hpp"
+#include <cassert>
+
+namespace Engine {
+
+// Index of the queue owned by the current thread, 0 for threads that are not workers
+static thread_local size_t worker_index = 0;
+static thread_local JobSystem* worker_owner = nullptr;
+// Waits in progress on the current thread, each one running jobs on top of the stack of the previous
+static thread_local size_t wait_nesting = 0;
+
+JobSystem::JobSystem(size_t thread_count) {
+    if (thread_count == 0) {
+        thread_count = 1;
+    }
+
+    for (size_t i = 0; i < thread_count; i++) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+
+    for (size_t i = 1; i < thread_count; i++) {
+        workers.emplace_back([this, i]() { workerLoop(i); });
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard lock{sleep_mutex};
+        running.store(false);
+    }
+    wake.notify_all();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+JobHandle JobSystem::create(std::function<void()> fn, const JobHandle& parent) {
+    auto job = std::make_shared<Job>();
+    job->fn = std::move(fn);
+
+    if (parent) {
+        assert(!isDone(parent) && "Cannot add a child to a finished job");
+        parent->unfinished.fetch_add(1, std::memory_order_relaxed);
+        job->parent = parent;
+    }
+
+    return job;
+}
+
+void JobSystem::depend(const JobHandle& job, const JobHandle& dependency) {
+    std::lock_guard lock{dependency->dependents_mutex};
+    if (dependency->finished) {
+        return;
+    }
+
+    job->blockers.fetch_add(1, std::memory_order_relaxed);
+    dependency->dependents.push_back(job);
+}
+
+void JobSystem::run(const JobHandle& job) {
+    // Drops the submission blocker, whoever releases the last blocker enqueues the job
+    if (job->blockers.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        push(job);
+    }
+}
+
+void JobSystem::push(JobHandle job) {
+    {
+        std::lock_guard lock{sleep_mutex};
+        queued.fetch_add(1, std::memory_order_release);
+    }
+
+    auto index = worker_owner == this ? worker_index : 0;
+    {
+        std::lock_guard lock{queues[index]->mutex};
+        queues[index]->jobs.push_back(std::move(job));
+    }
+    wake.notify_one();
+}
+
+// Whether ancestor is job itself or reached from it through the parent links
+static bool isDescendant(const Job& job, const Job* ancestor) {
+    for (auto node = &job; node; node = node->parent.get()) {
+        if (node == ancestor) {
+            return true;
+        }
+    }
+    return false;
+}
+
+JobHandle JobSystem::take(const Job* ancestor) {
+    auto own = worker_owner == this ? worker_index : 0;
+    auto eligible = [&](const JobHandle& job) { return !ancestor || isDescendant(*job, ancestor); };
+
+    // Own queue first, newest job first for locality
+    {
+        std::lock_guard lock{queues[own]->mutex};
+        auto& jobs = queues[own]->jobs;
+        if (auto it = std::find_if(jobs.rbegin(), jobs.rend(), eligible); it != jobs.rend()) {
+            auto job = std::move(*it);
+            jobs.erase(std::next(it).base());
+            queued.fetch_sub(1, std::memory_order_relaxed);
+            return job;
+        }
+    }
+
+    // Steal the oldest job of another queue, these tend to be the biggest chunks of work
+    for (size_t offset = 1; offset < queues.size(); offset++) {
+        auto& victim = *queues[(own + offset) % queues.size()];
+        std::unique_lock lock{victim.mutex, std::try_to_lock};
+        if (!lock.owns_lock()) {
+            continue;
+        }
+        if (auto it = std::find_if(victim.jobs.begin(), victim.jobs.end(), eligible); it != victim.jobs.end()) {
+            auto job = std::move(*it);
+            victim.jobs.erase(it);
+            queued.fetch_sub(1, std::memory_order_relaxed);
+            return job;
+        }
+    }
+
+    return nullptr;
+}
+
+void JobSystem::execute(const JobHandle& job) {
+    if (job->fn) {
+        job->fn();
+    }
+    finish(job.get());
+}
+
+void JobSystem::finish(Job* job) {
+    if (job->unfinished.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+        return;
+    }
+
+    std::vector<JobHandle> ready;
+    {
+        std::lock_guard lock{job->dependents_mutex};
+        job->finished = true;
+        ready.swap(job->dependents);
+    }
+
+    for (auto& dependent : ready) {
+        if (dependent->blockers.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            push(std::move(dependent));
+        }
+    }
+
+    if (job->parent) {
+        auto parent = std::move(job->parent);
+        finish(parent.get());
+    }
+}
+
+void JobSystem::wait(const JobHandle& job) {
+    // A job that waits while being run by another wait nests one more level. Past the limit only the awaited job's
+    // own descendants are run: they are needed to finish it anyway, and unlike unrelated jobs they cannot pile up
+    // deeper than the job itself forks.
+    auto ancestor = wait_nesting < MAX_WAIT_NESTING ? nullptr : job.get();
+
+    wait_nesting++;
+    while (!isDone(job)) {
+        if (auto next = take(ancestor)) {
+            execute(next);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    wait_nesting--;
+}
+
+void JobSystem::workerLoop(size_t index) {
+    worker_index = index;
+    worker_owner = this;
+
+    while (running.load(std::memory_order_acquire)) {
+        if (auto job = take()) {
+            execute(job);
+            continue;
+        }
+
+        std::unique_lock lock{sleep_mutex};
+        wake.wait(lock, [this]() { return !running.load() || queued.load() > 0; });
+    }
+}
+
+}; // namespace Engine
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Engine {
+
+struct Job;
+using JobHandle = std::shared_ptr<Job>;
+
+struct Job {
+    std::function<void()> fn;
+    JobHandle parent;
+
+    // Counts the job itself plus every unfinished child; the job is complete once it reaches zero
+    std::atomic<int> unfinished{1};
+    // Unresolved dependencies, plus one held until the job is submitted with JobSystem::run
+    std::atomic<int> blockers{1};
+
+    std::mutex dependents_mutex;
+    std::vector<JobHandle> dependents;
+    bool finished = false;
+};
+
+// Nested waits, i.e. jobs waiting inside a wait, that still help by running any other job
+constexpr size_t MAX_WAIT_NESTING = 8;
+
+// Work-stealing job system. Every worker owns a deque: it pushes and pops at the back, idle workers steal from the
+// front of the others. Threads that are not workers (e.g. the main thread) share queue 0. Waiting on a job never
+// blocks the thread, it keeps executing other jobs until the awaited one is done; deeper than MAX_WAIT_NESTING only
+// the awaited job's children (and theirs) are executed. Prefer dependencies over waiting inside a job.
+class JobSystem {
+  public:
+    // thread_count includes the calling thread, so 1 means everything runs inline inside wait()
+    explicit JobSystem(size_t thread_count = std::thread::hardware_concurrency());
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    size_t threadCount() const { return queues.size(); }
+
+    // Creates a job without submitting it. A job with a parent keeps the parent unfinished until it is done too.
+    JobHandle create(std::function<void()> fn, const JobHandle& parent = nullptr);
+
+    // job will not start before dependency has finished. Must be called before job is submitted.
+    void depend(const JobHandle& job, const JobHandle& dependency);
+
+    void run(const JobHandle& job);
+
+    JobHandle schedule(std::function<void()> fn, const JobHandle& parent = nullptr) {
+        auto job = create(std::move(fn), parent);
+        run(job);
+        return job;
+    }
+
+    void wait(const JobHandle& job);
+
+    static bool isDone(const JobHandle& job) { return job->unfinished.load(std::memory_order_acquire) == 0; }
+
+  private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<JobHandle> jobs;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+
+    std::atomic<bool> running{true};
+    std::atomic<size_t> queued{0};
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+
+    void push(JobHandle job);
+    JobHandle take(const Job* ancestor = nullptr); // only ancestor itself or its descendants, when given
+    void execute(const JobHandle& job);
+    void finish(Job* job);
+    void workerLoop(size_t index);
+};
+
+// Calls fn(begin, end) on consecutive chunks of chunk_size items covering [0, count) and returns once all are done.
+// Chunks run as jobs when a job system with more than one thread is given, inline otherwise.
+template <typename Fn> void forEachChunk(JobSystem* jobs, size_t count, size_t chunk_size, const Fn& fn) {
+    if (!jobs || jobs->threadCount() < 2 || count <= chunk_size) {
+        for (size_t begin = 0; begin < count; begin += chunk_size) {
+            fn(begin, std::min(count, begin + chunk_size));
+        }
+        return;
+    }
+
+    auto group = jobs->create(nullptr);
+    for (size_t begin = 0; begin < count; begin += chunk_size) {
+        auto end = std::min(count, begin + chunk_size);
+        jobs->schedule([&fn, begin, end]() { fn(begin, end); }, group);
+    }
+    jobs->run(group);
+    jobs->wait(group);
+}
+
+}; // namespace Engine
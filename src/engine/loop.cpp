@@ -0,0 +1,62 @@
+#include "engine/loop.hpp"
+#include <cassert>
+#include <chrono>
+
+namespace Engine {
+
+Loop::Loop(double simulation_hz, size_t max_catch_up_steps) : max_catch_up_steps{max_catch_up_steps} {
+    setSimulationRate(simulation_hz);
+}
+
+void Loop::setSimulationRate(double hz) {
+    assert(hz > 0);
+    step_length = 1.0 / hz;
+}
+
+float Loop::advance(double frame_time) {
+    accumulator += frame_time;
+
+    auto max_time = max_catch_up_steps * step_length;
+    if (accumulator > max_time) {
+        dropped_time += accumulator - max_time;
+        accumulator = max_time;
+    }
+
+    while (accumulator >= step_length) {
+        step();
+        accumulator -= step_length;
+    }
+
+    return getAlpha();
+}
+
+void Loop::step(size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (simulate) {
+            simulate(static_cast<float>(step_length));
+        }
+        step_count++;
+    }
+}
+
+void Loop::run() {
+    using Clock = std::chrono::steady_clock;
+    auto last_time = Clock::now();
+
+    while (!running || running()) {
+        if (headless) {
+            step();
+            continue;
+        }
+
+        auto time = Clock::now();
+        auto alpha = advance(std::chrono::duration<double>(time - last_time).count());
+        last_time = time;
+
+        if (render) {
+            render(alpha);
+        }
+    }
+}
+
+}; // namespace Engine
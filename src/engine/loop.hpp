@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <type_traits>
+
+namespace Engine {
+
+// Fixed timestep simulation loop. Real time is accumulated and consumed in steps of exactly 1 / simulation_hz, and
+// rendering gets the fraction of a step that is left over so it can interpolate between the last two states.
+class Loop {
+  public:
+    explicit Loop(double simulation_hz = 60.0, size_t max_catch_up_steps = 5);
+
+    // Called once per fixed step, with the step length in seconds
+    std::function<void(float step)> simulate;
+    // Called once per frame in run(), with the interpolation factor in [0, 1) between the previous and current step
+    std::function<void(float alpha)> render;
+    // run() keeps going while this returns true
+    std::function<bool()> running;
+
+    void setSimulationRate(double hz);
+    // Upper bound on steps per frame. When the simulation falls further behind, the excess time is dropped instead
+    // of spiralling into ever longer frames.
+    void setMaxCatchUpSteps(size_t steps) { max_catch_up_steps = steps; }
+    // Headless loops never render and run steps back to back, as fast as the simulation allows
+    void setHeadless(bool headless) { this->headless = headless; }
+
+    // Feeds frame_time seconds of real time, runs the steps that fit and returns the interpolation factor
+    float advance(double frame_time);
+
+    // Runs exactly count steps without rendering, regardless of real time
+    void step(size_t count = 1);
+
+    // Drives the loop from the steady clock (or back to back when headless) until running returns false
+    void run();
+
+    double getStep() const { return step_length; }
+    float getAlpha() const { return static_cast<float>(accumulator / step_length); }
+    uint64_t getStepCount() const { return step_count; }
+    double getSimulationTime() const { return step_count * step_length; }
+    // Real time thrown away because the simulation could not keep up
+    double getDroppedTime() const { return dropped_time; }
+
+  private:
+    double step_length;
+    size_t max_catch_up_steps;
+    bool headless = false;
+
+    double accumulator = 0.0;
+    double dropped_time = 0.0;
+    uint64_t step_count = 0;
+};
+
+// Simulation-side value with its previous state, for rendering in between two fixed steps
+template <typename T> class Interpolated {
+  public:
+    explicit Interpolated(const T& value = T{}) : previous{value}, current{value} {}
+
+    // Call once per simulation step
+    void set(const T& value) {
+        previous = current;
+        current = value;
+    }
+
+    // Moves without interpolating from the old value, e.g. for teleports
+    void reset(const T& value) { previous = current = value; }
+
+    const T& get() const { return current; }
+
+    T get(float alpha) const {
+        if constexpr (std::is_same_v<T, glm::quat>) {
+            return glm::slerp(previous, current, alpha);
+        } else {
+            return glm::mix(previous, current, alpha);
+        }
+    }
+
+  private:
+    T previous;
+    T current;
+};
+
+}; // namespace Engine
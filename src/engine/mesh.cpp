@@ -1,33 +1,642 @@
 #include "engine/mesh.hpp"
-#include "glm/gtc/type_ptr.hpp"
-#include <numeric>
 #include <algorithm>
+#include <cstddef>
+#include <numeric>
+#include <optional>
 #include "common.hpp"
 
 namespace Engine {
 
-Mesh::Mesh() : type{MeshType::Triangles}, widths{}, store{}, buffer{}, element_buffer{} {
-    glGenVertexArrays(1, &vao);
-    glGenBuffers(1, &vbo);
-    glGenBuffers(1, &ebo);
-}
-
-Mesh::~Mesh() {
-    glDeleteVertexArrays(1, &vao);
-    glDeleteBuffers(1, &vbo);
-    glDeleteBuffers(1, &ebo);
-}
+Mesh::Mesh()
+    : type{MeshType::Triangles}, vao{GpuVertexArray::create()}, vbo{GpuBuffer::create()}, ebo{GpuBuffer::create()},
+      store{}, element_buffer{}, buffer{} {}
 
 void Mesh::setElementBuffer(const uint *data, size_t count, MeshType type) {
     this->type = type;
+    indices_released = false;
     element_buffer.resize(count);
     std::copy_n(data, count, element_buffer.begin());
+    lods.clear();
+    current_lod = 0;
+    clearMeshlets();
+    elements_dirty = true;
 }
 
 void Mesh::setElementBuffer(const std::initializer_list<uint> &data, MeshType type) {
     this->type = type;
+    indices_released = false;
     element_buffer.resize(data.size());
     std::copy(data.begin(), data.end(), element_buffer.begin());
+    lods.clear();
+    current_lod = 0;
+    clearMeshlets();
+    elements_dirty = true;
+}
+
+void Mesh::setElementBuffer(std::vector<uint> &&data, MeshType type) {
+    this->type = type;
+    indices_released = false;
+    element_buffer = std::move(data);
+    lods.clear();
+    current_lod = 0;
+    clearMeshlets();
+    elements_dirty = true;
+}
+
+void Mesh::setUsage(MeshUsage usage) {
+    if (this->usage == usage) {
+        return;
+    }
+    // Where the GPU copy lives depends on the usage, so it has to be read back before the usage changes
+    restoreSource();
+    this->usage = usage;
+    vertex_capacity = 0;
+    layout_dirty = true;
+}
+
+void Mesh::setResidency(MeshResidency residency) {
+    this->residency = residency;
+    if (residency == MeshResidency::KeepAll) {
+        // Partial updates re-interleave into the kept buffer, so it has to be complete again
+        restoreSource();
+        if (!layout_dirty && buffer.size() != vertex_count * stride) {
+            layout_dirty = true;
+        }
+    } else if (!layout_dirty && !vertices_dirty && !elements_dirty) {
+        releaseCPUData();
+    }
+}
+
+void Mesh::restoreSource() {
+    if (!isSourceReleased()) {
+        return;
+    }
+
+    if (reload) {
+        // Fields and indices that were replaced since the release are newer than what reload sets, so they are kept
+        std::vector<std::pair<size_t, MeshField>> kept_fields;
+        for (size_t field = 0; field < store.size(); ++field) {
+            if (!isFieldReleased(field)) {
+                kept_fields.emplace_back(field, std::move(store[field]));
+            }
+        }
+        std::optional<std::pair<MeshType, std::vector<uint>>> kept_indices;
+        if (!indices_released) {
+            kept_indices.emplace(type, std::move(element_buffer));
+        }
+        released_fields.clear();
+        indices_released = false;
+
+        // Setting the fields again marks the whole vertex buffer for upload
+        layout_dirty = true;
+        reload(*this);
+
+        for (auto &[field, data] : kept_fields) {
+            std::visit([&](auto &xs) { takeField(field, std::move(xs)); }, data);
+        }
+        if (kept_indices) {
+            setElementBuffer(std::move(kept_indices->second), kept_indices->first);
+        }
+    } else {
+        readBackSource();
+        released_fields.clear();
+        indices_released = false;
+    }
+}
+
+template <typename Index>
+static void unpackIndexRange(const std::byte *in, size_t count, uint base, std::vector<uint> &out) {
+    for (size_t i = 0; i < count; i++) {
+        Index index;
+        std::memcpy(&index, in + i * sizeof(Index), sizeof(Index));
+        out.push_back(index + base);
+    }
+}
+
+// The GPU buffers stay valid, so nothing is marked for upload
+void Mesh::readBackSource() {
+    auto base = usage == MeshUsage::Stream ? segment * vertex_capacity : 0;
+    std::vector<std::byte> vertices(vertex_count * stride);
+    glBindBuffer(GL_COPY_READ_BUFFER, vbo);
+    glGetBufferSubData(GL_COPY_READ_BUFFER, base, vertices.size(), vertices.data());
+    for (size_t field = 0; field < store.size(); ++field) {
+        if (!isFieldReleased(field)) {
+            continue;
+        }
+        std::visit(
+            [&](auto &xs) {
+                xs.resize(vertex_count);
+                deinterleaveEncodedAttribute(field_formats[field], vertices.data() + formats[field].offset, stride,
+                                             xs.data(), vertex_count);
+            },
+            store[field]);
+    }
+
+    if (indices_released && !lod_sub_draws.empty()) {
+        std::vector<std::byte> packed(index_bytes);
+        glBindBuffer(GL_COPY_READ_BUFFER, ebo);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, 0, packed.size(), packed.data());
+
+        for (size_t lod = 0; lod < getLodCount(); lod++) {
+            auto &indices = lod == 0 ? element_buffer : lods[lod - 1].indices;
+            indices.clear();
+            for (auto i = lod_sub_draws[lod]; i < lod_sub_draws[lod + 1]; i++) {
+                auto &sub_draw = sub_draws[i];
+                auto in = packed.data() + sub_draw.offset;
+                auto base_vertex = static_cast<uint>(sub_draw.base_vertex);
+                switch (index_type) {
+                case GL_UNSIGNED_BYTE:
+                    unpackIndexRange<uint8_t>(in, sub_draw.count, base_vertex, indices);
+                    break;
+                case GL_UNSIGNED_SHORT:
+                    unpackIndexRange<uint16_t>(in, sub_draw.count, base_vertex, indices);
+                    break;
+                default:
+                    unpackIndexRange<uint>(in, sub_draw.count, base_vertex, indices);
+                    break;
+                }
+            }
+        }
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+void Mesh::releaseCPUData() {
+    if (residency == MeshResidency::KeepAll) {
+        return;
+    }
+
+    // Swapping with empty vectors gives the memory back, clear() would keep the capacity
+    std::vector<std::byte>().swap(buffer);
+    std::vector<std::byte>().swap(index_data);
+
+    if (residency == MeshResidency::GPUOnly) {
+        for (auto &field : store) {
+            std::visit([](auto &xs) { std::remove_cvref_t<decltype(xs)>().swap(xs); }, field);
+        }
+        std::vector<uint>().swap(element_buffer);
+        for (auto &lod : lods) {
+            std::vector<uint>().swap(lod.indices);
+        }
+        released_fields.assign(store.size(), true);
+        indices_released = true;
+    }
+}
+
+Mesh::MemoryReport Mesh::getMemoryReport() const {
+    MemoryReport report{0, 0};
+    for (auto &field : store) {
+        std::visit(
+            [&](auto &xs) {
+                using T = typename std::remove_cvref_t<decltype(xs)>::value_type;
+                report.cpu_bytes += xs.capacity() * sizeof(T);
+            },
+            field);
+    }
+    report.cpu_bytes += buffer.capacity() + index_data.capacity() + element_buffer.capacity() * sizeof(uint);
+    for (auto &lod : lods) {
+        report.cpu_bytes += lod.indices.capacity() * sizeof(uint);
+    }
+    report.cpu_bytes += meshlets.capacity() * sizeof(Meshlet);
+
+    auto segments = usage == MeshUsage::Stream ? MESH_FRAMES_IN_FLIGHT : 1;
+    report.gpu_bytes = vertex_capacity * segments + element_capacity + instance_capacity;
+    return report;
+}
+
+// Whether field can be stored in format, true while its type is not known yet
+static bool isFieldFormatSupported(const MeshField &field, VertexFormat format) {
+    return std::visit(
+        [&](auto &xs) {
+            using T = typename std::remove_cvref_t<decltype(xs)>::value_type;
+            return isVertexFormatSupported<T>(format);
+        },
+        field);
+}
+
+bool Mesh::setFormat(size_t index, VertexFormat format) {
+    if (getFormat(index) == format) {
+        return true;
+    }
+    // The GPU copy is decoded with the current formats, so it has to be read back before they change
+    restoreSource();
+    bool supported = index >= store.size() || isFieldFormatSupported(store[index], format);
+    if (!supported) {
+        DBG("Vertex format " << static_cast<int>(format) << " cannot store field " << index << ", keeping Float");
+        format = VertexFormat::Float;
+    }
+    if (field_formats.size() < index + 1) {
+        field_formats.resize(index + 1, VertexFormat::Float);
+    }
+    field_formats[index] = format;
+    layout_dirty = true;
+    return supported;
+}
+
+Mesh::VertexSizeReport Mesh::getVertexSizeReport() {
+    VertexSizeReport report{0, 0};
+    auto count = getVertexCount();
+    for (size_t field = 0; field < store.size(); ++field) {
+        std::visit(
+            [&](auto &xs) {
+                using T = typename std::remove_cvref_t<decltype(xs)>::value_type;
+                report.float_bytes += count * sizeof(T);
+                report.packed_bytes += count * vertexFormatSize(getFormat(field), T::length());
+            },
+            store[field]);
+    }
+    return report;
+}
+
+size_t Mesh::getVertexSize() const {
+    size_t size = 0;
+    for (size_t field = 0; field < store.size(); ++field) {
+        std::visit(
+            [&](auto &xs) {
+                using T = typename std::remove_cvref_t<decltype(xs)>::value_type;
+                size += vertexFormatSize(getFormat(field), T::length());
+            },
+            store[field]);
+    }
+    return size;
+}
+
+Mesh::OptimizationReport Mesh::optimize(float overdraw_threshold) {
+    // The analysis works on triangles only, and nothing needs to be read back for other types
+    if (type != MeshType::Triangles) {
+        return {};
+    }
+
+    restoreSource();
+    auto count = getVertexCount();
+    auto vertex_size = getVertexSize();
+
+    OptimizationReport report;
+    report.cache_before = analyzeVertexCache(element_buffer, count);
+    report.fetch_before = analyzeVertexFetch(element_buffer, count, vertex_size);
+
+    if (element_buffer.empty() || store.empty()) {
+        report.cache_after = report.cache_before;
+        report.fetch_after = report.fetch_before;
+        return report;
+    }
+
+    optimizeVertexCache(element_buffer, count);
+    optimizeOverdraw(element_buffer, getPositions(), overdraw_threshold);
+
+    auto remap = optimizeVertexFetchRemap(element_buffer, count);
+    for (auto &lod : lods) {
+        for (auto &index : lod.indices) {
+            index = remap[index];
+        }
+    }
+    for (auto &field : store) {
+        std::visit(
+            [&](auto &xs) {
+                auto old = xs;
+                xs.resize(count);
+                for (size_t vertex = 0; vertex < count; vertex++) {
+                    xs[remap[vertex]] = old[vertex];
+                }
+            },
+            field);
+    }
+
+    clearMeshlets();
+
+    report.cache_after = analyzeVertexCache(element_buffer, count);
+    report.fetch_after = analyzeVertexFetch(element_buffer, count, vertex_size);
+
+    layout_dirty = true;
+    elements_dirty = true;
+    return report;
+}
+
+Mesh::WeldReport Mesh::weld(float epsilon, JobSystem *jobs) {
+    restoreSource();
+    auto count = getVertexCount();
+    WeldReport report{count, count};
+    if (store.empty() || count == 0) {
+        return report;
+    }
+
+    std::vector<WeldStream> streams;
+    for (auto &field : store) {
+        std::visit(
+            [&](auto &xs) {
+                using T = typename std::remove_cvref_t<decltype(xs)>::value_type;
+                streams.push_back({&xs[0][0], T::length()});
+            },
+            field);
+    }
+
+    size_t unique;
+    auto remap = weldVertices(streams, count, epsilon, unique, jobs);
+    report.vertices_after = unique;
+    if (unique == count) {
+        return report;
+    }
+
+    if (element_buffer.empty()) {
+        element_buffer.resize(count);
+        std::iota(element_buffer.begin(), element_buffer.end(), 0u);
+    }
+    for (auto &index : element_buffer) {
+        index = remap[index];
+    }
+    for (auto &lod : lods) {
+        for (auto &index : lod.indices) {
+            index = remap[index];
+        }
+    }
+
+    // Each merged vertex keeps the values of the first vertex of its group, which is the first to map to its index
+    for (auto &field : store) {
+        std::visit(
+            [&](auto &xs) {
+                uint next = 0;
+                for (size_t vertex = 0; vertex < count; vertex++) {
+                    if (remap[vertex] == next) {
+                        xs[next++] = xs[vertex];
+                    }
+                }
+                xs.resize(unique);
+            },
+            field);
+    }
+
+    clearMeshlets();
+    layout_dirty = true;
+    elements_dirty = true;
+    return report;
+}
+
+// Normals and tangents
+void Mesh::generateNormals(size_t field, NormalMode mode, float crease_angle, JobSystem *jobs) {
+    restoreSource();
+    if (type != MeshType::Triangles || store.empty() || getVertexCount() == 0) {
+        return;
+    }
+    if (mode == NormalMode::Faceted) {
+        splitVertices();
+    }
+
+    std::vector<uint> sequential;
+    auto indices = getTriangleIndices(sequential);
+    takeField(field, computeNormals(indices, getPositions(), mode == NormalMode::Smooth, crease_angle, jobs));
+}
+
+void Mesh::generateTangents(size_t field, size_t normal_field, size_t uv_field, JobSystem *jobs) {
+    restoreSource();
+    if (type != MeshType::Triangles || store.empty() || getVertexCount() == 0) {
+        return;
+    }
+    assert(normal_field < store.size() && std::holds_alternative<std::vector<glm::vec3>>(store[normal_field]) &&
+           "Normals have to be glm::vec3");
+    assert(uv_field < store.size() && std::holds_alternative<std::vector<glm::vec2>>(store[uv_field]) &&
+           "UVs have to be glm::vec2");
+
+    std::vector<uint> sequential;
+    auto indices = getTriangleIndices(sequential);
+    auto tangents = computeTangents(indices, getPositions(), std::get<std::vector<glm::vec3>>(store[normal_field]),
+                                    std::get<std::vector<glm::vec2>>(store[uv_field]), jobs);
+    takeField(field, std::move(tangents));
+}
+
+std::span<const uint> Mesh::getTriangleIndices(std::vector<uint> &sequential) {
+    if (!element_buffer.empty()) {
+        return element_buffer;
+    }
+    sequential.resize(getVertexCount());
+    std::iota(sequential.begin(), sequential.end(), 0u);
+    return sequential;
+}
+
+// Gives every index its own copy of the vertex, in index order
+void Mesh::splitVertices() {
+    if (element_buffer.empty()) {
+        return;
+    }
+
+    for (auto &field : store) {
+        std::visit(
+            [&](auto &xs) {
+                std::remove_cvref_t<decltype(xs)> split(element_buffer.size());
+                for (size_t i = 0; i < element_buffer.size(); i++) {
+                    split[i] = xs[element_buffer[i]];
+                }
+                xs = std::move(split);
+            },
+            field);
+    }
+    std::iota(element_buffer.begin(), element_buffer.end(), 0u);
+
+    lods.clear();
+    current_lod = 0;
+    clearMeshlets();
+    layout_dirty = true;
+    elements_dirty = true;
+}
+
+std::vector<glm::vec3> Mesh::getPositions() {
+    auto count = getVertexCount();
+    std::vector<glm::vec3> positions;
+    positions.reserve(count);
+    if (store.empty()) {
+        return positions;
+    }
+    std::visit(
+        [&](auto &xs) {
+            using T = typename std::remove_cvref_t<decltype(xs)>::value_type;
+            for (size_t vertex = 0; vertex < count; vertex++) {
+                if constexpr (T::length() >= 3) {
+                    positions.emplace_back(xs[vertex]);
+                } else {
+                    positions.emplace_back(xs[vertex], 0.f);
+                }
+            }
+        },
+        store[0]);
+    return positions;
+}
+
+void Mesh::updateBounds() {
+    bounds = std::visit(
+        [](auto &xs) {
+            using T = typename std::remove_cvref_t<decltype(xs)>::value_type;
+            if constexpr (T::length() >= 3) {
+                return computeBounds(std::span<const T>(xs));
+            } else {
+                return Bounds{};
+            }
+        },
+        store[0]);
+}
+
+void Mesh::clearMeshlets() {
+    meshlets.clear();
+    meshlet_ranges.clear();
+    meshlets_culled = false;
+}
+
+size_t Mesh::buildMeshlets(size_t max_vertices, size_t max_triangles) {
+    restoreSource();
+    clearMeshlets();
+    if (type != MeshType::Triangles || element_buffer.empty() || store.empty()) {
+        return 0;
+    }
+
+    meshlets = Engine::buildMeshlets(element_buffer, getPositions(), max_vertices, max_triangles);
+    elements_dirty = true;
+    return meshlets.size();
+}
+
+size_t Mesh::cullMeshlets(const glm::mat4 &transform) {
+    meshlet_ranges.clear();
+    meshlets_culled = !meshlets.empty();
+
+    auto view = makeClusterCullView(transform);
+    size_t visible = 0;
+
+    // A mesh entirely outside the frustum culls all of its meshlets without testing them
+    auto outside = std::ranges::any_of(view.planes, [&](auto &plane) {
+        return glm::dot(glm::vec3(plane), bounds.center) + plane.w < -bounds.radius;
+    });
+    if (outside) {
+        tested_meshlets.fetch_add(meshlets.size(), std::memory_order_relaxed);
+        culled_meshlets.fetch_add(meshlets.size(), std::memory_order_relaxed);
+        return 0;
+    }
+
+    for (auto &meshlet : meshlets) {
+        if (!isMeshletVisible(meshlet, view)) {
+            continue;
+        }
+        visible++;
+
+        // Meshlets follow each other in the element buffer, so runs of visible ones become a single range
+        auto last = meshlet_ranges.empty() ? nullptr : &meshlet_ranges.back();
+        if (last && last->first + last->count == meshlet.first_index) {
+            last->count += meshlet.index_count;
+        } else {
+            meshlet_ranges.push_back({meshlet.first_index, meshlet.index_count});
+        }
+    }
+
+    tested_meshlets.fetch_add(meshlets.size(), std::memory_order_relaxed);
+    culled_meshlets.fetch_add(meshlets.size() - visible, std::memory_order_relaxed);
+    return visible;
+}
+
+size_t Mesh::generateLods(size_t levels, float reduction, float max_error) {
+    restoreSource();
+    lods.clear();
+    current_lod = 0;
+    elements_dirty = true;
+    if (type != MeshType::Triangles || element_buffer.empty() || store.empty()) {
+        return getLodCount();
+    }
+
+    auto count = getVertexCount();
+    auto positions = getPositions();
+
+    // Each level is simplified from the previous one, which is much faster than starting from the full mesh every
+    // time; the errors add up, so every level only gets what is left of max_error
+    float error = 0.f;
+    for (size_t level = 0; level < levels && error < max_error; level++) {
+        const auto &previous = lods.empty() ? element_buffer : lods.back().indices;
+        auto target = static_cast<size_t>(previous.size() / 3 * reduction) * 3;
+
+        float level_error = 0.f;
+        auto indices = simplifyMesh(previous, positions, target, max_error - error, &level_error);
+        if (indices.empty() || indices.size() > previous.size() * 0.95f) {
+            break;
+        }
+
+        optimizeVertexCache(indices, count);
+        error += level_error;
+        lods.push_back({std::move(indices), error});
+    }
+
+    return getLodCount();
+}
+
+void Mesh::setLodThreshold(float pixels, float hysteresis) {
+    lod_threshold = pixels;
+    lod_hysteresis = hysteresis;
+}
+
+float Mesh::getProjectedSize(const glm::mat4 &transform, float viewport_height) const {
+    if (bounds.isEmpty()) {
+        return 0.f;
+    }
+    auto center = transform * glm::vec4(bounds.center, 1.f);
+    // The camera is inside the sphere or behind it
+    if (center.w <= bounds.radius) {
+        return std::numeric_limits<float>::max();
+    }
+    // The second row of the matrix scales model space lengths into clip space y, which spans 2 units of the viewport
+    auto scale = glm::length(glm::vec3(transform[0][1], transform[1][1], transform[2][1]));
+    return bounds.radius * scale / center.w * viewport_height;
+}
+
+size_t Mesh::selectLod(const glm::mat4 &transform, float viewport_height) {
+    if (lods.empty()) {
+        return current_lod;
+    }
+
+    // Errors are relative to the mesh size, so this is roughly how many pixels each level is off by
+    auto size = getProjectedSize(transform, viewport_height);
+    auto pixels = [&](size_t lod) { return lod == 0 ? 0.f : lods[lod - 1].error * size; };
+
+    size_t lod = lods.size();
+    while (lod > 0 && pixels(lod) > lod_threshold) {
+        lod--;
+    }
+    while (lod > current_lod && pixels(lod) > lod_threshold * (1.f - lod_hysteresis)) {
+        lod--;
+    }
+
+    current_lod = lod;
+    return current_lod;
+}
+
+size_t Mesh::getLodIndexCount(size_t lod) const {
+    if (!indices_released) {
+        return lod == 0 ? element_buffer.size() : lods[lod - 1].indices.size();
+    }
+
+    // Only the sub-draws remember the sizes of released index lists
+    size_t count = 0;
+    for (auto i = lod_sub_draws[lod]; i < lod_sub_draws[lod + 1]; i++) {
+        count += sub_draws[i].count;
+    }
+    return count;
+}
+
+void Mesh::setSplitIndices(bool split) {
+    split_indices = split;
+    elements_dirty = true;
+}
+
+void Mesh::setByteIndices(bool allow) {
+    byte_indices = allow;
+    elements_dirty = true;
+}
+
+void Mesh::markDirty(size_t field, size_t begin, size_t end) {
+    // A full rebuild is pending anyway
+    if (layout_dirty) {
+        return;
+    }
+    // Without the interleaved copy there is nothing to patch, everything is interleaved again
+    if (residency != MeshResidency::KeepAll) {
+        layout_dirty = true;
+        return;
+    }
+    dirty[field].begin = std::min(dirty[field].begin, begin);
+    dirty[field].end = std::max(dirty[field].end, end);
+    vertices_dirty = true;
 }
 
 void Mesh::draw() {
@@ -36,16 +645,161 @@ void Mesh::draw() {
     auto primitive_type = static_cast<GLenum>(type);
     glBindVertexArray(vao);
 
-    if (!element_buffer.empty()) {
-        glDrawElements(primitive_type, element_buffer.size(), GL_UNSIGNED_INT, 0);
-    } else {
+    if (lod_sub_draws.empty()) {
         glDrawArrays(primitive_type, 0, vertex_count);
+    } else if (current_lod == 0 && meshlets_culled) {
+        auto drawn = drawVisibleMeshlets(primitive_type);
+        drawn_triangles.fetch_add(drawn / 3, std::memory_order_relaxed);
+        full_triangles.fetch_add(getLodTriangleCount(0), std::memory_order_relaxed);
+    } else {
+        auto first = lod_sub_draws[current_lod];
+        auto last = lod_sub_draws[current_lod + 1];
+        if (last - first == 1 && sub_draws[first].base_vertex == 0) {
+            glDrawElements(primitive_type, sub_draws[first].count, index_type,
+                           reinterpret_cast<void *>(sub_draws[first].offset));
+        } else {
+            for (auto i = first; i < last; i++) {
+                glDrawElementsBaseVertex(primitive_type, sub_draws[i].count, index_type,
+                                         reinterpret_cast<void *>(sub_draws[i].offset), sub_draws[i].base_vertex);
+            }
+        }
+
+        if (type == MeshType::Triangles) {
+            drawn_triangles.fetch_add(getLodTriangleCount(current_lod), std::memory_order_relaxed);
+            full_triangles.fetch_add(getLodTriangleCount(0), std::memory_order_relaxed);
+        }
+    }
+
+    // The segment may only be rewritten once the GPU is done with this draw
+    if (usage == MeshUsage::Stream) {
+        fences[segment].reset(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+    }
+
+    glBindVertexArray(0);
+}
+
+void Mesh::setInstances(const MeshInstance *data, size_t count) {
+    if (!instance_vbo) {
+        instance_vbo = GpuBuffer::create();
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, instance_vbo);
+
+        // A mat4 attribute is four vec4 columns, each with its own location
+        constexpr auto stride = static_cast<GLsizei>(sizeof(MeshInstance));
+        for (GLuint column = 0; column < 4; column++) {
+            auto offset = offsetof(MeshInstance, model) + column * sizeof(glm::vec4);
+            glVertexAttribPointer(MESH_INSTANCE_LOCATION + column, 4, GL_FLOAT, GL_FALSE, stride,
+                                  reinterpret_cast<void *>(offset));
+        }
+        glVertexAttribPointer(MESH_INSTANCE_LOCATION + 4, 4, GL_FLOAT, GL_FALSE, stride,
+                              reinterpret_cast<void *>(offsetof(MeshInstance, color)));
+        glVertexAttribPointer(MESH_INSTANCE_LOCATION + 5, 1, GL_FLOAT, GL_FALSE, stride,
+                              reinterpret_cast<void *>(offsetof(MeshInstance, texture_layer)));
+        for (GLuint location = MESH_INSTANCE_LOCATION; location < MESH_INSTANCE_LOCATION + 6; location++) {
+            glEnableVertexAttribArray(location);
+            glVertexAttribDivisor(location, 1);
+        }
+        glBindVertexArray(0);
+    }
+
+    auto size = count * sizeof(MeshInstance);
+    glBindBuffer(GL_ARRAY_BUFFER, instance_vbo);
+    if (size > instance_capacity) {
+        instance_capacity = size;
+        glBufferData(GL_ARRAY_BUFFER, size, data, GL_STREAM_DRAW);
+    } else {
+        // Orphaning the old storage lets the driver hand out fresh memory instead of waiting for pending draws
+        glBufferData(GL_ARRAY_BUFFER, instance_capacity, nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, size, data);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    instance_count = count;
+    uploaded_bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+void Mesh::drawInstanced() {
+    if (instance_count == 0) {
+        return;
+    }
+    transferToGPU();
+
+    auto primitive_type = static_cast<GLenum>(type);
+    auto instances = static_cast<GLsizei>(instance_count);
+    glBindVertexArray(vao);
+
+    if (lod_sub_draws.empty()) {
+        glDrawArraysInstanced(primitive_type, 0, vertex_count, instances);
+    } else {
+        auto first = lod_sub_draws[current_lod];
+        auto last = lod_sub_draws[current_lod + 1];
+        if (last - first == 1 && sub_draws[first].base_vertex == 0) {
+            glDrawElementsInstanced(primitive_type, sub_draws[first].count, index_type,
+                                    reinterpret_cast<void *>(sub_draws[first].offset), instances);
+        } else {
+            for (auto i = first; i < last; i++) {
+                glDrawElementsInstancedBaseVertex(primitive_type, sub_draws[i].count, index_type,
+                                                  reinterpret_cast<void *>(sub_draws[i].offset), instances,
+                                                  sub_draws[i].base_vertex);
+            }
+        }
+
+        if (type == MeshType::Triangles) {
+            drawn_triangles.fetch_add(getLodTriangleCount(current_lod) * instance_count, std::memory_order_relaxed);
+            full_triangles.fetch_add(getLodTriangleCount(0) * instance_count, std::memory_order_relaxed);
+        }
+    }
+
+    if (usage == MeshUsage::Stream) {
+        fences[segment].reset(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
     }
 
     glBindVertexArray(0);
 }
 
+// Expects the VAO to be bound, returns the number of indices drawn
+size_t Mesh::drawVisibleMeshlets(GLenum primitive_type) {
+    multi_counts.clear();
+    multi_offsets.clear();
+    multi_base_vertices.clear();
+    bool based = false;
+    size_t drawn = 0;
+
+    // A range may cross the boundary between two sub-draws of a split element buffer
+    for (auto &range : meshlet_ranges) {
+        for (auto i = lod_sub_draws[0]; i < lod_sub_draws[1]; i++) {
+            auto &sub_draw = sub_draws[i];
+            auto sub_draw_first = sub_draw.offset / index_size;
+            auto first = std::max(range.first, sub_draw_first);
+            auto end = std::min(range.first + range.count, sub_draw_first + sub_draw.count);
+            if (first < end) {
+                multi_counts.push_back(static_cast<GLsizei>(end - first));
+                multi_offsets.push_back(reinterpret_cast<const void *>(first * index_size));
+                multi_base_vertices.push_back(sub_draw.base_vertex);
+                based |= sub_draw.base_vertex != 0;
+            }
+        }
+        drawn += range.count;
+    }
+
+    auto draw_count = static_cast<GLsizei>(multi_counts.size());
+    if (draw_count == 0) {
+        return 0;
+    }
+    if (based) {
+        glMultiDrawElementsBaseVertex(primitive_type, multi_counts.data(), index_type, multi_offsets.data(), draw_count,
+                                      multi_base_vertices.data());
+    } else {
+        glMultiDrawElements(primitive_type, multi_counts.data(), index_type, multi_offsets.data(), draw_count);
+    }
+    return drawn;
+}
+
 size_t Mesh::getVertexCount() {
+    // Released fields are empty, the count of the uploaded vertices still holds for them
+    if (std::ranges::find(released_fields, true) != released_fields.end()) {
+        return vertex_count;
+    }
     vertex_count = std::numeric_limits<size_t>::max();
     for (size_t field = 0; field < store.size(); field++) {
         size_t size = std::visit([](auto &v) { return v.size(); }, store[field]);
@@ -59,51 +813,295 @@ size_t Mesh::getVertexCount() {
     return vertex_count;
 }
 
+// Meshes with up to this many fields, all stored as Float, are interleaved through a compile-time VertexLayout
+constexpr size_t MAX_STATIC_LAYOUT_FIELDS = 4;
+
+// Resolves the type of one field per recursion step, then interleaves with the layout of the resolved types. Returns
+// false when there are more fields than MAX_STATIC_LAYOUT_FIELDS.
+template <typename... Resolved>
+static bool interleaveStaticLayout(std::byte *out, size_t vertex_count, std::span<const MeshField> fields,
+                                   const Resolved *...streams) {
+    if constexpr (sizeof...(Resolved) > 0) {
+        if (fields.empty()) {
+            VertexLayout<Resolved...>::interleave(out, vertex_count, streams...);
+            return true;
+        }
+    }
+    if constexpr (sizeof...(Resolved) == MAX_STATIC_LAYOUT_FIELDS) {
+        return false;
+    } else {
+        return std::visit(
+            [&](const auto &xs) {
+                return interleaveStaticLayout(out, vertex_count, fields.subspan(1), streams..., xs.data());
+            },
+            fields.front());
+    }
+}
+
 void Mesh::transferToGPU() {
-    if (!buffer.empty()) {
+    if (!layout_dirty && !vertices_dirty && !elements_dirty) {
         return;
     }
+    // New indices alone are uploaded without the vertex source
+    if (layout_dirty || vertices_dirty || indices_released) {
+        restoreSource();
+    }
+    bool rebuild = layout_dirty;
 
-    size_t total_width = std::accumulate(widths.begin(), widths.end(), 0);
-
-    vertex_count = getVertexCount();
-    buffer.resize(vertex_count * total_width);
+    glBindVertexArray(vao);
 
-    size_t offset = 0;
+    if (rebuild) {
+        vertex_count = getVertexCount();
 
-    for (size_t i = 0; i < vertex_count; i++) {
-        offset = 0;
+        // The layout is resolved once per field, then every field is copied with a loop specialized for its type
+        field_formats.resize(store.size(), VertexFormat::Float);
+        formats.clear();
+        stride = 0;
         for (size_t field = 0; field < store.size(); ++field) {
+            // The format may have been set before the field's data, or the data replaced with another type since
+            if (!isFieldFormatSupported(store[field], field_formats[field])) {
+                DBG("Vertex format " << static_cast<int>(field_formats[field]) << " cannot store field " << field
+                                     << ", falling back to Float");
+                field_formats[field] = VertexFormat::Float;
+            }
             std::visit(
                 [&](auto &xs) {
-                    std::copy_n(glm::value_ptr(xs[i]), widths[field], buffer.begin() + total_width * i + offset);
+                    using T = typename std::remove_cvref_t<decltype(xs)>::value_type;
+                    formats.push_back(vertexAttributeFormat(field_formats[field], T::length(), stride));
+                    stride += vertexFormatSize(field_formats[field], T::length());
                 },
                 store[field]);
-            offset += widths[field];
         }
+
+        buffer.resize(vertex_count * stride);
+        auto is_float = [](VertexFormat format) { return format == VertexFormat::Float; };
+        bool all_float = std::ranges::all_of(field_formats, is_float);
+        if (store.empty() || store.size() > MAX_STATIC_LAYOUT_FIELDS || !all_float ||
+            !interleaveStaticLayout(buffer.data(), vertex_count, store)) {
+            for (size_t field = 0; field < store.size(); ++field) {
+                interleave(field, 0, vertex_count);
+            }
+        }
+        uploadVertices(0, vertex_count, true);
+        layout_dirty = false;
+    } else if (vertices_dirty) {
+        DirtyRange vertices;
+        for (size_t field = 0; field < store.size(); ++field) {
+            auto &range = dirty[field];
+            if (!range.empty()) {
+                interleave(field, range.begin, range.end);
+                vertices.begin = std::min(vertices.begin, range.begin);
+                vertices.end = std::max(vertices.end, range.end);
+            }
+        }
+        uploadVertices(vertices.begin, vertices.end, false);
     }
 
-    glBindVertexArray(vao);
+    dirty.assign(store.size(), {});
+    vertices_dirty = false;
+
+    if (elements_dirty) {
+        uploadElements();
+    }
 
+    glBindVertexArray(0);
+    releaseCPUData();
+}
+
+void Mesh::interleave(size_t field, size_t begin, size_t end) {
+    std::visit(
+        [&](auto &xs) {
+            interleaveEncodedAttribute(field_formats[field], buffer.data() + begin * stride + formats[field].offset,
+                                       stride, xs.data() + begin, end - begin);
+        },
+        store[field]);
+}
+
+// Expects the VAO to be bound
+void Mesh::uploadVertices(size_t begin, size_t end, bool layout_changed) {
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, buffer.size() * sizeof(float), buffer.data(), GL_STATIC_DRAW);
 
-    if (!element_buffer.empty()) {
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, element_buffer.size() * sizeof(uint), element_buffer.data(),
-                     GL_STATIC_DRAW);
+    if (usage == MeshUsage::Stream) {
+        // Segments hold the whole vertex buffer, the next one is filled while the GPU may still read the others
+        if (buffer.size() > vertex_capacity) {
+            for (auto &fence : fences) {
+                fence.reset();
+            }
+            vertex_capacity = buffer.size();
+            glBufferData(GL_ARRAY_BUFFER, MESH_FRAMES_IN_FLIGHT * vertex_capacity, nullptr, GL_STREAM_DRAW);
+        }
+
+        segment = (segment + 1) % MESH_FRAMES_IN_FLIGHT;
+        if (auto &fence = fences[segment]) {
+            glClientWaitSync(fence.get(), GL_SYNC_FLUSH_COMMANDS_BIT, std::numeric_limits<GLuint64>::max());
+            fence.reset();
+        }
+
+        auto offset = segment * vertex_capacity;
+        if (!buffer.empty()) {
+            auto mapped = glMapBufferRange(GL_ARRAY_BUFFER, offset, buffer.size(),
+                                           GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+            std::copy(buffer.begin(), buffer.end(), static_cast<std::byte *>(mapped));
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+        }
+        uploaded_bytes.fetch_add(buffer.size(), std::memory_order_relaxed);
+
+        // Every segment starts at a different offset, so the attribute pointers move with it
+        setVertexAttributes(formats, stride, 0, offset);
+        return;
     }
 
-    offset = 0;
+    if (buffer.size() > vertex_capacity || (usage == MeshUsage::Static && layout_changed)) {
+        vertex_capacity = buffer.size();
+        auto hint = usage == MeshUsage::Static ? GL_STATIC_DRAW : GL_DYNAMIC_DRAW;
+        glBufferData(GL_ARRAY_BUFFER, vertex_capacity, buffer.data(), hint);
+        uploaded_bytes.fetch_add(buffer.size(), std::memory_order_relaxed);
+    } else if (begin < end) {
+        auto offset = begin * stride;
+        auto size = (end - begin) * stride;
+        glBufferSubData(GL_ARRAY_BUFFER, offset, size, buffer.data() + offset);
+        uploaded_bytes.fetch_add(size, std::memory_order_relaxed);
+    }
 
-    for (size_t field = 0; field < store.size(); ++field) {
-        glVertexAttribPointer(field, widths[field], GL_FLOAT, GL_FALSE, total_width * sizeof(float),
-                              (void *)(offset * sizeof(float)));
-        glEnableVertexAttribArray(field);
-        offset += widths[field];
+    if (layout_changed) {
+        setVertexAttributes(formats, stride);
     }
+}
 
-    glBindVertexArray(0);
+template <typename Index> static void packIndexRange(std::byte *out, const uint *indices, size_t count, uint base) {
+    for (size_t i = 0; i < count; i++) {
+        auto index = static_cast<Index>(indices[i] - base);
+        std::memcpy(out + i * sizeof(Index), &index, sizeof(Index));
+    }
+}
+
+void Mesh::packIndices() {
+    sub_draws.clear();
+    lod_sub_draws.clear();
+    if (element_buffer.empty()) {
+        index_data.clear();
+        return;
+    }
+
+    // Every level shares one index buffer, each taking a contiguous range of sub-draws
+    auto levels = getLodCount();
+    auto level_indices = [&](size_t lod) -> const std::vector<uint> & {
+        return lod == 0 ? element_buffer : lods[lod - 1].indices;
+    };
+
+    // Coarser levels only ever reference vertices of the full mesh
+    auto max_index = std::ranges::max(element_buffer);
+    size_t total = 0;
+    for (size_t lod = 0; lod < levels; lod++) {
+        total += level_indices(lod).size();
+    }
+
+    // Bytes only when asked for, some hardware has no native 8 bit index fetch and converts them in the driver
+    index_size = sizeof(uint);
+    index_type = GL_UNSIGNED_INT;
+    if (byte_indices && max_index <= std::numeric_limits<uint8_t>::max()) {
+        index_size = sizeof(uint8_t);
+        index_type = GL_UNSIGNED_BYTE;
+    } else if (max_index <= std::numeric_limits<uint16_t>::max()) {
+        index_size = sizeof(uint16_t);
+        index_type = GL_UNSIGNED_SHORT;
+    }
+
+    size_t primitive_size = 0;
+    switch (type) {
+    case MeshType::Points:
+        primitive_size = 1;
+        break;
+    case MeshType::Lines:
+        primitive_size = 2;
+        break;
+    case MeshType::Triangles:
+        primitive_size = 3;
+        break;
+    default:
+        break;
+    }
+
+    bool split = split_indices && index_type == GL_UNSIGNED_INT && primitive_size > 0;
+    if (split) {
+        index_size = sizeof(uint16_t);
+        index_type = GL_UNSIGNED_SHORT;
+    }
+
+    index_data.resize(total * index_size);
+    size_t level_start = 0;
+    for (size_t lod = 0; lod < levels; lod++) {
+        const auto &indices = level_indices(lod);
+        auto first_sub_draw = sub_draws.size();
+        lod_sub_draws.push_back(first_sub_draw);
+
+        // Greedily grow each sub-draw until one more primitive would span more vertices than 16 bits address
+        if (split) {
+            size_t begin = 0;
+            uint min = std::numeric_limits<uint>::max();
+            uint max = 0;
+            for (size_t primitive = 0; primitive < indices.size(); primitive += primitive_size) {
+                auto first = indices.begin() + primitive;
+                auto [primitive_min, primitive_max] = std::minmax_element(first, first + primitive_size);
+                auto new_min = std::min(min, *primitive_min);
+                auto new_max = std::max(max, *primitive_max);
+
+                if (new_max - new_min > std::numeric_limits<uint16_t>::max()) {
+                    sub_draws.push_back({static_cast<GLsizei>(primitive - begin), (level_start + begin) * index_size,
+                                         static_cast<GLint>(min)});
+                    begin = primitive;
+                    new_min = *primitive_min;
+                    new_max = *primitive_max;
+                }
+                min = new_min;
+                max = new_max;
+            }
+            sub_draws.push_back({static_cast<GLsizei>(indices.size() - begin), (level_start + begin) * index_size,
+                                 static_cast<GLint>(min)});
+        } else {
+            sub_draws.push_back({static_cast<GLsizei>(indices.size()), level_start * index_size, 0});
+        }
+
+        for (auto i = first_sub_draw; i < sub_draws.size(); i++) {
+            auto &sub_draw = sub_draws[i];
+            auto out = index_data.data() + sub_draw.offset;
+            auto source = indices.data() + (sub_draw.offset / index_size - level_start);
+            auto base = static_cast<uint>(sub_draw.base_vertex);
+            switch (index_type) {
+            case GL_UNSIGNED_BYTE:
+                packIndexRange<uint8_t>(out, source, sub_draw.count, base);
+                break;
+            case GL_UNSIGNED_SHORT:
+                packIndexRange<uint16_t>(out, source, sub_draw.count, base);
+                break;
+            default:
+                packIndexRange<uint>(out, source, sub_draw.count, base);
+                break;
+            }
+        }
+        level_start += indices.size();
+    }
+    lod_sub_draws.push_back(sub_draws.size());
+}
+
+// Expects the VAO to be bound
+void Mesh::uploadElements() {
+    packIndices();
+
+    auto size = index_data.size();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+
+    if (size > element_capacity || usage == MeshUsage::Static) {
+        element_capacity = size;
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, index_data.data(),
+                     usage == MeshUsage::Static ? GL_STATIC_DRAW : GL_DYNAMIC_DRAW);
+    } else {
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, size, index_data.data());
+    }
+
+    index_bytes = size;
+    uploaded_bytes.fetch_add(size, std::memory_order_relaxed);
+    elements_dirty = false;
 }
 
 }; // namespace Engine
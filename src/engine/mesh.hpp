@@ -1,7 +1,23 @@
 #pragma once
 
+#include "engine/bounds.hpp"
+#include "engine/gpu_resource.hpp"
+#include "engine/mesh_cluster.hpp"
+#include "engine/mesh_normals.hpp"
+#include "engine/mesh_optimize.hpp"
+#include "engine/mesh_simplify.hpp"
+#include "engine/mesh_weld.hpp"
+#include "engine/vertex_format.hpp"
+#include "engine/vertex_layout.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <functional>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include <limits>
+#include <span>
 #include <variant>
 #include <vector>
 
@@ -17,73 +33,417 @@ enum class MeshType : GLenum {
     TriangleFan = GL_TRIANGLE_FAN,
 };
 
+enum class MeshUsage {
+    Static,  // re-uploaded whole with glBufferData whenever it changes
+    Dynamic, // changed vertex ranges are re-interleaved and uploaded with glBufferSubData
+    Stream,  // rewritten into a ring of MESH_FRAMES_IN_FLIGHT buffer segments, each guarded by a fence
+};
+
+constexpr size_t MESH_FRAMES_IN_FLIGHT = 3;
+
+// Which CPU side copies a mesh keeps once it is uploaded
+enum class MeshResidency {
+    KeepAll,        // source fields, interleaved vertices and packed indices
+    KeepSourceOnly, // source fields and indices; any vertex change re-interleaves everything
+    GPUOnly,        // nothing, the source is reloaded or read back from the GPU when it is needed again
+};
+
+enum class NormalMode {
+    Smooth,  // averaged over the triangles around each position, except across creases (see computeNormals)
+    Faceted, // every triangle gets its own three vertices, all with its face normal
+};
+
+// Per-instance attributes of Mesh::drawInstanced, uploaded as one contiguous array. The model matrix takes the four
+// locations from MESH_INSTANCE_LOCATION on, followed by the color and the texture layer.
+struct MeshInstance {
+    glm::mat4 model{1.f};
+    glm::vec4 color{1.f};
+    float texture_layer = 0.f;
+};
+
+constexpr GLuint MESH_INSTANCE_LOCATION = 8;
+
+// Source data of one vertex attribute of a Mesh
+using MeshField = std::variant<std::vector<glm::vec2>, std::vector<glm::vec3>, std::vector<glm::vec4>>;
+
 // Assumes that the first element is the vertex position
 class Mesh {
   public:
     explicit Mesh();
-    ~Mesh();
+
+    // GL objects are owned by this mesh alone; a moved-from mesh is empty
+    Mesh(const Mesh &) = delete;
+    Mesh &operator=(const Mesh &) = delete;
+    Mesh(Mesh &&) noexcept = default;
+    Mesh &operator=(Mesh &&) noexcept = default;
 
     MeshType type;
 
     template <typename T> void setVertexPositions(const T *data, size_t count) {
         static_assert(std::is_same_v<T, glm::vec3> || std::is_same_v<T, glm::vec4>, "T must be glm::vec3 or glm::vec4");
-
-        if (store.size() < 1) {
-            store.resize(1);
-            widths.resize(1);
-        }
-
-        widths[0] = sizeof(T) / sizeof(float);
-
-        store[0] = std::vector<T>(data, data + count);
-
-        buffer.clear();
+        setField(0, data, count);
     }
 
     template <typename T> void setVertexPositions(const std::initializer_list<T> &data) {
         setVertexPositions(data.begin(), data.size()); 
     }
 
+    // Takes over data without copying it
+    template <typename T> void setVertexPositions(std::vector<T> &&data) {
+        static_assert(std::is_same_v<T, glm::vec3> || std::is_same_v<T, glm::vec4>, "T must be glm::vec3 or glm::vec4");
+        takeField(0, std::move(data));
+    }
+
     template <typename T> void setAssociatedData(size_t index, const T *data, size_t count) {
         static_assert(std::is_same_v<T, glm::vec2> || std::is_same_v<T, glm::vec3> || std::is_same_v<T, glm::vec4>,
                       "T must be glm::vec2 or glm::vec3 or glm::vec4");
+        setField(index, data, count);
+    }
 
-        if (store.size() < index + 1) {
-            store.resize(index + 1);
-            widths.resize(index + 1);
-        }
+    template <typename T> void setAssociatedData(size_t index, const std::initializer_list<T> &data) {
+        setAssociatedData<T>(index, data.begin(), data.size());
+    }
 
-        widths[index] = sizeof(T) / sizeof(float);
+    template <typename T> void setAssociatedData(size_t index, std::vector<T> &&data) {
+        static_assert(std::is_same_v<T, glm::vec2> || std::is_same_v<T, glm::vec3> || std::is_same_v<T, glm::vec4>,
+                      "T must be glm::vec2 or glm::vec3 or glm::vec4");
+        takeField(index, std::move(data));
+    }
 
-        store[index] = std::vector<T>(data, data + count);
+    // Overwrites count values of field index (0 being the positions) starting at vertex first. The field keeps its
+    // type and size, so only the touched vertices are re-interleaved and uploaded on the next draw.
+    template <typename T> void updateData(size_t index, size_t first, const T *data, size_t count) {
+        restoreSource();
+        assert(index < store.size() && std::holds_alternative<std::vector<T>>(store[index]) &&
+               "Field does not exist or has a different type");
+        auto &field = std::get<std::vector<T>>(store[index]);
+        assert(first + count <= field.size() && "Update is out of range");
 
-        buffer.clear();
+        std::copy_n(data, count, field.begin() + first);
+        markDirty(index, first, first + count);
+        if constexpr (T::length() >= 3) {
+            if (index == 0) {
+                expandBounds(bounds, std::span<const T>(data, count));
+            }
+        }
     }
 
-    template <typename T> void setAssociatedData(size_t index, const std::initializer_list<T> &data) {
-        setAssociatedData<T>(index, data.begin(), data.size());
+    // Box and sphere around the positions, recomputed whenever they are set. Partial updates only grow them, so they
+    // stay conservative without a pass over every position.
+    const Bounds &getBounds() const { return bounds; }
+
+    // Stores field index (0 being the positions) in a packed format on the GPU. Values are encoded while
+    // interleaving, the source data keeps full precision. A format that cannot store the field's type (e.g.
+    // Octahedral for a vec2) is rejected: the field stays Float and false is returned. A format set before the
+    // field's data is checked once the layout is built, and falls back to Float the same way.
+    bool setFormat(size_t index, VertexFormat format);
+    VertexFormat getFormat(size_t index) const {
+        return index < field_formats.size() ? field_formats[index] : VertexFormat::Float;
     }
 
+    // Vertex buffer size with every field as plain floats, and as actually laid out with the field formats
+    struct VertexSizeReport {
+        size_t float_bytes;
+        size_t packed_bytes;
+
+        size_t saved() const { return float_bytes - packed_bytes; }
+    };
+    VertexSizeReport getVertexSizeReport();
+
+    struct OptimizationReport {
+        VertexCacheStats cache_before, cache_after;
+        VertexFetchStats fetch_before, fetch_after;
+    };
+
+    // Reorders the triangles of an indexed triangle mesh for the vertex cache and then for overdraw, and the vertices
+    // in order of first use, remapping every field. Does nothing for other mesh types, and returns an empty report.
+    OptimizationReport optimize(float overdraw_threshold = 1.05f);
+
+    struct WeldReport {
+        size_t vertices_before;
+        size_t vertices_after;
+    };
+
+    // Merges the vertices that are equal in every field, within epsilon as described at weldVertices, and remaps the
+    // element buffer and the levels of detail. A mesh without an element buffer gets one. Meshlets are dropped.
+    WeldReport weld(float epsilon = 0.f, JobSystem *jobs = nullptr);
+
+    // Computes angle weighted normals of a triangle mesh into field, as glm::vec3. Faceted splits the vertices of
+    // indexed meshes first, which drops the levels of detail. Smooth keeps edges sharper than crease_angle hard. Does
+    // nothing for other mesh types.
+    void generateNormals(size_t field, NormalMode mode = NormalMode::Smooth, float crease_angle = DEFAULT_CREASE_ANGLE,
+                         JobSystem *jobs = nullptr);
+
+    // Computes tangents of a triangle mesh into field, as glm::vec4 with the bitangent sign in w (see
+    // computeTangents), from the glm::vec3 normals and glm::vec2 UVs in the given fields
+    void generateTangents(size_t field, size_t normal_field, size_t uv_field, JobSystem *jobs = nullptr);
+
+    // Builds up to levels coarser index buffers for an indexed triangle mesh, each with about reduction times the
+    // triangles of the previous one. All levels index the same vertex buffer. Stops early once the simplification
+    // error would exceed max_error (relative to the mesh size) or the triangle count stops shrinking. Returns the
+    // number of levels including the full mesh.
+    size_t generateLods(size_t levels = 4, float reduction = 0.5f, float max_error = 0.05f);
+    size_t getLodCount() const { return lods.size() + 1; }
+    size_t getLodTriangleCount(size_t lod) const { return getLodIndexCount(lod) / 3; }
+
+    // Levels are chosen so that their error stays below pixels on screen. A coarser level is only switched to once
+    // its error is below (1 - hysteresis) * pixels, so meshes near a boundary do not flicker between two levels.
+    void setLodThreshold(float pixels, float hysteresis = 0.25f);
+
+    // Diameter in pixels of the mesh's bounding sphere, transform being projection * view * model
+    float getProjectedSize(const glm::mat4 &transform, float viewport_height) const;
+
+    // Picks the level the next draws use from the projected size, returns it
+    size_t selectLod(const glm::mat4 &transform, float viewport_height);
+    void setLod(size_t lod) { current_lod = std::min(lod, lods.size()); }
+    size_t getLod() const { return current_lod; }
+
+    // Splits the full detail triangle list into meshlets, reordering its triangles so that each meshlet is a
+    // contiguous range of it. Bounds and normal cones are taken from the current positions; meshlets are dropped
+    // when the element buffer or the vertex order changes. Returns the number of meshlets.
+    size_t buildMeshlets(size_t max_vertices = MESHLET_MAX_VERTICES, size_t max_triangles = MESHLET_MAX_TRIANGLES);
+    const std::vector<Meshlet> &getMeshlets() const { return meshlets; }
+
+    // Culls the meshlets against the frustum of transform (projection * view * model) and by their normal cones,
+    // assuming counter-clockwise front faces. Until the next call, draws of the full detail level only cover the
+    // visible meshlets, merged into as few ranges as possible. Returns the number of visible meshlets.
+    size_t cullMeshlets(const glm::mat4 &transform);
+
+    // Changing the usage reallocates the GPU buffer on the next draw
+    void setUsage(MeshUsage usage);
+    MeshUsage getUsage() const { return usage; }
+
+    // Takes effect after the next upload, or right away for a mesh that is already uploaded
+    void setResidency(MeshResidency residency);
+    MeshResidency getResidency() const { return residency; }
+
+    // Called to bring back the source of a GPUOnly mesh, by setting its fields and element buffer again. Without
+    // one, the source is read back from the GPU buffers, with packed formats keeping only their precision.
+    void setReloadCallback(std::function<void(Mesh &)> reload) { this->reload = std::move(reload); }
+
+    // Brings back the released source fields and indices. Everything that reads them calls this first, setters that
+    // replace a whole field or the element buffer do not, so they never wait on a read back.
+    void restoreSource();
+    bool isSourceReleased() const {
+        return indices_released || std::ranges::find(released_fields, true) != released_fields.end();
+    }
+
+    // Bytes held by this mesh's CPU side copies, and by its GPU buffers
+    struct MemoryReport {
+        size_t cpu_bytes;
+        size_t gpu_bytes;
+    };
+    MemoryReport getMemoryReport() const;
+
     size_t getVertexCount();
 
+    // The source element buffer and fields, brought back first when they were released
+    const std::vector<uint> &getElementBuffer() {
+        restoreSource();
+        return element_buffer;
+    }
+    template <typename T> const std::vector<T> &getField(size_t index) {
+        restoreSource();
+        assert(index < store.size() && std::holds_alternative<std::vector<T>>(store[index]) &&
+               "Field does not exist or has a different type");
+        return std::get<std::vector<T>>(store[index]);
+    }
+
     void setElementBuffer(const uint *data, size_t count, MeshType type = MeshType::Triangles);
 
     void setElementBuffer(const std::initializer_list<uint> &data, MeshType type = MeshType::Triangles);
 
+    void setElementBuffer(std::vector<uint> &&data, MeshType type = MeshType::Triangles);
+
+    // When the indices do not fit 16 bits, split the draw into several that each address less than 65536
+    // vertices from their own base vertex, so every index can still be 16 bits. Only for list primitives.
+    void setSplitIndices(bool split);
+
+    // Indices are at least 16 bits by default: 8 bit indices save little and some hardware has no native 8 bit index
+    // fetch, so the driver converts them. Allows GL_UNSIGNED_BYTE for meshes of at most 256 vertices.
+    void setByteIndices(bool allow);
+
+    // Index type and size of the element buffer as uploaded, GL_UNSIGNED_BYTE / SHORT / INT
+    GLenum getIndexType() const { return index_type; }
+    size_t getIndexBytes() const { return index_bytes; }
+
     void draw();
 
+    // Copies count instances into the mesh's instance buffer, used by every drawInstanced until the next call
+    void setInstances(const MeshInstance *data, size_t count);
+    size_t getInstanceCount() const { return instance_count; }
+
+    // Draws the current level once per instance in a single call. Meshlet culling does not apply, as every instance
+    // has its own transform.
+    void drawInstanced();
+
+    // Bytes uploaded to vertex and element buffers by all meshes since the last call. Call once per frame.
+    static size_t takeUploadedBytes() { return uploaded_bytes.exchange(0, std::memory_order_relaxed); }
+
+    // Triangles drawn by all meshes since the last call, and how many they would have been at full detail
+    struct TriangleStats {
+        size_t drawn;
+        size_t full;
+    };
+    static TriangleStats takeTriangleStats() {
+        return {drawn_triangles.exchange(0, std::memory_order_relaxed),
+                full_triangles.exchange(0, std::memory_order_relaxed)};
+    }
+
+    // Meshlets tested and culled by all meshes since the last call
+    struct ClusterStats {
+        size_t tested;
+        size_t culled;
+    };
+    static ClusterStats takeClusterStats() {
+        return {tested_meshlets.exchange(0, std::memory_order_relaxed),
+                culled_meshlets.exchange(0, std::memory_order_relaxed)};
+    }
+
   private:
-    GLuint vao, vbo, ebo; // vertex array object, vertex buffer object, element buffer object
+    // Part of the element buffer drawn with glDrawElementsBaseVertex
+    struct SubDraw {
+        GLsizei count;
+        size_t offset; // bytes into the element buffer
+        GLint base_vertex;
+    };
+
+    struct Lod {
+        std::vector<uint> indices;
+        float error; // relative to the bounding box diagonal
+    };
+
+    // Indices into the full detail level
+    struct IndexRange {
+        size_t first;
+        size_t count;
+    };
+
+    struct DirtyRange {
+        size_t begin = std::numeric_limits<size_t>::max();
+        size_t end = 0;
+
+        bool empty() const { return begin >= end; }
+    };
+
+    GpuVertexArray vao; // vertex array object
+    GpuBuffer vbo, ebo; // vertex buffer object, element buffer object
 
-    std::vector<size_t> widths;
     size_t vertex_count;
 
-    std::vector<std::variant<std::vector<glm::vec2>, std::vector<glm::vec3>, std::vector<glm::vec4>>> store;
+    std::vector<MeshField> store;
 
     std::vector<uint> element_buffer;
-    std::vector<float> buffer;
+    std::vector<std::byte> index_data; // element_buffer packed into the smallest index type
+    GLenum index_type = GL_UNSIGNED_INT;
+    size_t index_size = sizeof(uint);
+    size_t index_bytes = 0;
+    std::vector<SubDraw> sub_draws;
+    bool split_indices = false;
+    bool byte_indices = false;
+
+    std::vector<Lod> lods;             // coarser levels after the full element buffer
+    std::vector<size_t> lod_sub_draws; // first sub-draw of every level, and the end of the last one
+    size_t current_lod = 0;
+    float lod_threshold = 1.f;
+    float lod_hysteresis = 0.25f;
+
+    std::vector<Meshlet> meshlets;
+    std::vector<IndexRange> meshlet_ranges; // visible after the last cullMeshlets
+    bool meshlets_culled = false;
+    std::vector<GLsizei> multi_counts;      // glMultiDrawElements arguments, kept to avoid allocating every draw
+    std::vector<const void *> multi_offsets;
+    std::vector<GLint> multi_base_vertices;
+
+    Bounds bounds;
+
+    std::vector<std::byte> buffer; // interleaved vertices, released after upload unless residency is KeepAll
+    std::vector<VertexFormat> field_formats;
+    std::vector<VertexAttributeFormat> formats;
+    size_t stride;
+
+    MeshUsage usage = MeshUsage::Static;
+    MeshResidency residency = MeshResidency::KeepAll;
+    bool layout_dirty = true;     // the whole buffer has to be interleaved and uploaded again
+    std::vector<bool> released_fields; // per field, only the type is kept until restoreSource or a new value
+    bool indices_released = false;     // element_buffer and the LOD index lists, the sub-draws keep their sizes
+    std::function<void(Mesh &)> reload;
+    std::vector<DirtyRange> dirty; // per field, vertices changed since the last upload
+    bool vertices_dirty = false;
+    bool elements_dirty = false;
+
+    size_t vertex_capacity = 0; // bytes of GPU vertex storage, per segment for MeshUsage::Stream
+    size_t element_capacity = 0;
+    size_t segment = 0;
+    std::array<GpuSync, MESH_FRAMES_IN_FLIGHT> fences;
+
+    GpuBuffer instance_vbo; // created by the first setInstances
+    size_t instance_count = 0;
+    size_t instance_capacity = 0;
+
+    inline static std::atomic<size_t> uploaded_bytes{0};
+    inline static std::atomic<size_t> drawn_triangles{0};
+    inline static std::atomic<size_t> full_triangles{0};
+    inline static std::atomic<size_t> tested_meshlets{0};
+    inline static std::atomic<size_t> culled_meshlets{0};
+
+    // Replacing a field with one of the same type and size keeps the layout, anything else rebuilds the buffer
+    template <typename T> void setField(size_t index, const T *data, size_t count) {
+        if (store.size() < index + 1) {
+            store.resize(index + 1);
+            layout_dirty = true;
+        }
+
+        auto existing = std::get_if<std::vector<T>>(&store[index]);
+        if (existing && existing->size() == count && !isFieldReleased(index)) {
+            std::copy_n(data, count, existing->begin());
+            markDirty(index, 0, count);
+        } else {
+            store[index] = std::vector<T>(data, data + count);
+            layout_dirty = true;
+        }
+        if (isFieldReleased(index)) {
+            released_fields[index] = false;
+        }
+        if (index == 0) {
+            updateBounds();
+        }
+    }
+
+    template <typename T> void takeField(size_t index, std::vector<T> &&data) {
+        if (store.size() < index + 1) {
+            store.resize(index + 1);
+        }
+        store[index] = std::move(data);
+        if (isFieldReleased(index)) {
+            released_fields[index] = false;
+        }
+        layout_dirty = true;
+        if (index == 0) {
+            updateBounds();
+        }
+    }
+
+    void markDirty(size_t field, size_t begin, size_t end);
+    bool isFieldReleased(size_t field) const { return field < released_fields.size() && released_fields[field]; }
+    size_t getVertexSize() const;
+    std::vector<glm::vec3> getPositions();
+    void clearMeshlets();
+    void updateBounds();
+
+    // The element buffer, or for meshes without one 0, 1, 2, ... written to sequential
+    std::span<const uint> getTriangleIndices(std::vector<uint> &sequential);
+    void splitVertices();
+    size_t getLodIndexCount(size_t lod) const;
+    void releaseCPUData();
+    void readBackSource();
+    size_t drawVisibleMeshlets(GLenum primitive_type);
 
     void transferToGPU();
+    void interleave(size_t field, size_t begin, size_t end);
+    void uploadVertices(size_t begin, size_t end, bool layout_changed);
+    void packIndices();
+    void uploadElements();
 };
 
 }; // namespace Engine
@@ -0,0 +1,202 @@
+#include "engine/mesh_cluster.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <glm/gtc/matrix_access.hpp>
+#include <limits>
+#include <numeric>
+
+namespace Engine {
+
+constexpr uint NO_TRIANGLE = std::numeric_limits<uint>::max();
+
+// Cones whose normals spread further than this from the axis are never back-facing as a whole
+constexpr float MIN_CONE_DOT = 0.1f;
+
+// Meshlet construction
+std::vector<Meshlet> buildMeshlets(std::span<uint> indices, std::span<const glm::vec3> positions, size_t max_vertices,
+                                   size_t max_triangles) {
+    assert(indices.size() % 3 == 0);
+    assert(max_vertices >= 3 && max_triangles >= 1);
+    auto triangle_count = indices.size() / 3;
+    auto vertex_count = positions.size();
+
+    std::vector<Meshlet> meshlets;
+    if (triangle_count == 0) {
+        return meshlets;
+    }
+
+    // Triangles of every vertex, in compressed rows; emitted triangles are swapped out of the live part of a row
+    std::vector<uint> first_triangle(vertex_count + 1, 0);
+    for (auto index : indices) {
+        first_triangle[index + 1]++;
+    }
+    std::partial_sum(first_triangle.begin(), first_triangle.end(), first_triangle.begin());
+
+    std::vector<uint> vertex_triangles(indices.size());
+    std::vector<uint> remaining(vertex_count, 0);
+    for (size_t i = 0; i < indices.size(); i++) {
+        auto vertex = indices[i];
+        vertex_triangles[first_triangle[vertex] + remaining[vertex]++] = static_cast<uint>(i / 3);
+    }
+
+    std::vector<glm::vec3> normals(triangle_count);
+    for (size_t triangle = 0; triangle < triangle_count; triangle++) {
+        auto &a = positions[indices[triangle * 3]];
+        auto &b = positions[indices[triangle * 3 + 1]];
+        auto &c = positions[indices[triangle * 3 + 2]];
+        auto n = glm::cross(b - a, c - a);
+        auto length = glm::length(n);
+        normals[triangle] = length > 0.f ? n / length : glm::vec3{0.f};
+    }
+
+    std::vector<bool> emitted(triangle_count, false);
+    std::vector<bool> in_meshlet(vertex_count, false);
+    std::vector<uint> meshlet_vertices;
+    std::vector<uint> meshlet_triangles;
+    glm::vec3 normal_sum{0.f};
+
+    std::vector<uint> result;
+    result.reserve(indices.size());
+
+    auto finish = [&]() {
+        if (meshlet_triangles.empty()) {
+            return;
+        }
+
+        Meshlet meshlet;
+        meshlet.first_index = static_cast<uint>(result.size());
+        meshlet.index_count = static_cast<uint>(meshlet_triangles.size() * 3);
+        for (auto triangle : meshlet_triangles) {
+            result.insert(result.end(), &indices[triangle * 3], &indices[triangle * 3] + 3);
+        }
+
+        glm::vec3 min{std::numeric_limits<float>::max()};
+        glm::vec3 max{std::numeric_limits<float>::lowest()};
+        for (auto vertex : meshlet_vertices) {
+            min = glm::min(min, positions[vertex]);
+            max = glm::max(max, positions[vertex]);
+        }
+        meshlet.center = (min + max) * 0.5f;
+        meshlet.radius = 0.f;
+        for (auto vertex : meshlet_vertices) {
+            meshlet.radius = std::max(meshlet.radius, glm::length(positions[vertex] - meshlet.center));
+            in_meshlet[vertex] = false;
+        }
+
+        // The axis is the average normal; the cutoff is the sine of the widest angle a normal makes with it
+        auto length = glm::length(normal_sum);
+        meshlet.cone_axis = length > 0.f ? normal_sum / length : glm::vec3{0.f, 0.f, 1.f};
+        float min_dot = length > 0.f ? 1.f : -1.f;
+        for (auto triangle : meshlet_triangles) {
+            if (normals[triangle] != glm::vec3{0.f}) {
+                min_dot = std::min(min_dot, glm::dot(normals[triangle], meshlet.cone_axis));
+            }
+        }
+        meshlet.cone_cutoff = min_dot <= MIN_CONE_DOT ? 1.f : std::sqrt(1.f - min_dot * min_dot);
+
+        meshlets.push_back(meshlet);
+        meshlet_vertices.clear();
+        meshlet_triangles.clear();
+        normal_sum = glm::vec3{0.f};
+    };
+
+    size_t scan_cursor = 0;
+    while (true) {
+        // Prefer the live triangle adding the fewest vertices, then the one closest to the meshlet's facing
+        auto best = NO_TRIANGLE;
+        size_t best_new = 4;
+        float best_dot = std::numeric_limits<float>::lowest();
+        for (auto vertex : meshlet_vertices) {
+            auto begin = first_triangle[vertex];
+            for (auto j = begin; j < begin + remaining[vertex]; j++) {
+                auto triangle = vertex_triangles[j];
+                auto t = &indices[triangle * 3];
+                size_t new_vertices = !in_meshlet[t[0]] + !in_meshlet[t[1]] + !in_meshlet[t[2]];
+                auto dot = glm::dot(normals[triangle], normal_sum);
+                if (new_vertices < best_new || (new_vertices == best_new && dot > best_dot)) {
+                    best = triangle;
+                    best_new = new_vertices;
+                    best_dot = dot;
+                }
+            }
+        }
+
+        // Nothing adjacent is left, the next meshlet starts at the next unemitted triangle in input order
+        if (best == NO_TRIANGLE) {
+            finish();
+            while (scan_cursor < triangle_count && emitted[scan_cursor]) {
+                scan_cursor++;
+            }
+            if (scan_cursor == triangle_count) {
+                break;
+            }
+            best = static_cast<uint>(scan_cursor);
+            best_new = 3;
+        } else if (meshlet_vertices.size() + best_new > max_vertices || meshlet_triangles.size() == max_triangles) {
+            finish();
+            best_new = 3;
+        }
+
+        emitted[best] = true;
+        auto t = &indices[best * 3];
+        for (int k = 0; k < 3; k++) {
+            auto vertex = t[k];
+            if (!in_meshlet[vertex]) {
+                in_meshlet[vertex] = true;
+                meshlet_vertices.push_back(vertex);
+            }
+
+            auto begin = vertex_triangles.begin() + first_triangle[vertex];
+            auto end = begin + remaining[vertex];
+            std::iter_swap(std::find(begin, end, best), end - 1);
+            remaining[vertex]--;
+        }
+        meshlet_triangles.push_back(best);
+        normal_sum += normals[best];
+    }
+
+    std::ranges::copy(result, indices.begin());
+    return meshlets;
+}
+
+// Culling
+ClusterCullView makeClusterCullView(const glm::mat4 &transform) {
+    ClusterCullView view;
+
+    // Gribb and Hartmann: each plane is the w row plus or minus one of the others, in the space transform maps from
+    auto w = glm::row(transform, 3);
+    for (int axis = 0; axis < 3; axis++) {
+        auto row = glm::row(transform, axis);
+        view.planes[axis * 2] = w + row;
+        view.planes[axis * 2 + 1] = w - row;
+    }
+    for (auto &plane : view.planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+
+    // The eye is the only point mapped to clip space x = y = w = 0; orthographic projections put it at infinity
+    auto eye = glm::inverse(transform) * glm::vec4{0.f, 0.f, 1.f, 0.f};
+    view.has_eye = std::abs(eye.w) > std::numeric_limits<float>::epsilon();
+    view.eye = view.has_eye ? glm::vec3(eye) / eye.w : glm::vec3{0.f};
+    return view;
+}
+
+bool isMeshletVisible(const Meshlet &meshlet, const ClusterCullView &view) {
+    for (auto &plane : view.planes) {
+        if (glm::dot(glm::vec3(plane), meshlet.center) + plane.w < -meshlet.radius) {
+            return false;
+        }
+    }
+
+    // Every normal in the cone points away from the eye, for any point of the bounding sphere
+    if (view.has_eye && meshlet.cone_cutoff < 1.f) {
+        auto direction = meshlet.center - view.eye;
+        if (glm::dot(direction, meshlet.cone_axis) >= meshlet.cone_cutoff * glm::length(direction) + meshlet.radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}; // namespace Engine
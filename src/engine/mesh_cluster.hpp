@@ -0,0 +1,43 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <span>
+#include <sys/types.h>
+#include <vector>
+
+namespace Engine {
+
+constexpr size_t MESHLET_MAX_VERTICES = 64;
+constexpr size_t MESHLET_MAX_TRIANGLES = 124;
+
+// A contiguous run of a triangle list touching at most MESHLET_MAX_VERTICES vertices
+struct Meshlet {
+    uint first_index;
+    uint index_count;
+    glm::vec3 center;
+    float radius;
+    glm::vec3 cone_axis;
+    float cone_cutoff; // sine of the normal cone's half angle, 1 when the cone is too wide to ever be back-facing
+};
+
+// Frustum planes and eye position in the space of the meshlets, extracted from a projection * view * model matrix
+struct ClusterCullView {
+    std::array<glm::vec4, 6> planes;
+    glm::vec3 eye;
+    bool has_eye; // false for orthographic projections, which skip the normal cone test
+};
+
+// Reorders the triangles of a triangle list so that every meshlet is a contiguous range of it, growing each meshlet
+// through triangles adjacent to it. Returns the meshlets in index order.
+std::vector<Meshlet> buildMeshlets(std::span<uint> indices, std::span<const glm::vec3> positions,
+                                   size_t max_vertices = MESHLET_MAX_VERTICES,
+                                   size_t max_triangles = MESHLET_MAX_TRIANGLES);
+
+ClusterCullView makeClusterCullView(const glm::mat4 &transform);
+
+// False if the meshlet's bounding sphere is outside the frustum or all its triangles face away from the eye
+bool isMeshletVisible(const Meshlet &meshlet, const ClusterCullView &view);
+
+}; // namespace Engine
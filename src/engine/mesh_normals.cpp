@@ -0,0 +1,209 @@
+#include "engine/mesh_normals.hpp"
+#include "engine/mesh_weld.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <numeric>
+
+namespace Engine {
+
+constexpr size_t NORMAL_CHUNK = 1 << 14; // triangles or vertices per job
+
+// Corners of every group of vertices, in compressed rows. Triangles write what they add to each of their corners into
+// a slot of their own, and every group then sums its own row, so no two jobs ever add to the same value and the sums
+// do not depend on the scheduling.
+struct CornerRows {
+    std::vector<uint> first; // offset of every group's row in corners, and the end of the last one
+    std::vector<uint> corners;
+};
+
+// group maps vertices to groups; when empty every vertex is a group of its own
+static CornerRows buildCornerRows(std::span<const uint> indices, std::span<const uint> group, size_t group_count) {
+    auto group_of = [&](uint vertex) { return group.empty() ? vertex : group[vertex]; };
+
+    CornerRows rows{std::vector<uint>(group_count + 1, 0), std::vector<uint>(indices.size())};
+    for (auto index : indices) {
+        rows.first[group_of(index) + 1]++;
+    }
+    std::partial_sum(rows.first.begin(), rows.first.end(), rows.first.begin());
+
+    std::vector<uint> cursor(rows.first.begin(), rows.first.end() - 1);
+    for (size_t corner = 0; corner < indices.size(); corner++) {
+        rows.corners[cursor[group_of(indices[corner])]++] = static_cast<uint>(corner);
+    }
+    return rows;
+}
+
+static float angleBetween(const glm::vec3& a, const glm::vec3& b) {
+    auto lengths = glm::length(a) * glm::length(b);
+    return lengths > 0.f ? std::acos(std::clamp(glm::dot(a, b) / lengths, -1.f, 1.f)) : 0.f;
+}
+
+// Normalizes v, or returns fallback when it has no direction
+static glm::vec3 normalizeOr(const glm::vec3& v, const glm::vec3& fallback) {
+    auto length = glm::length(v);
+    return length > 0.f ? v / length : fallback;
+}
+
+static glm::vec3 anyPerpendicular(const glm::vec3& n) {
+    return glm::normalize(glm::cross(n, std::abs(n.x) < 0.9f ? glm::vec3{1.f, 0.f, 0.f} : glm::vec3{0.f, 1.f, 0.f}));
+}
+
+// Groups of the vertices at exactly the same position
+static std::vector<uint> positionGroups(std::span<const glm::vec3> positions, size_t& group_count, JobSystem* jobs) {
+    WeldStream stream{&positions[0].x, 3};
+    return weldVertices({&stream, 1}, positions.size(), 0.f, group_count, jobs);
+}
+
+// Normals
+std::vector<glm::vec3> computeNormals(std::span<const uint> indices, std::span<const glm::vec3> positions,
+                                      bool by_position, float crease_angle, JobSystem* jobs) {
+    assert(indices.size() % 3 == 0);
+    auto vertex_count = positions.size();
+    if (vertex_count == 0) {
+        return {};
+    }
+
+    std::vector<glm::vec3> contributions(indices.size());
+    forEachChunk(jobs, indices.size() / 3, NORMAL_CHUNK, [&](size_t begin, size_t end) {
+        for (size_t triangle = begin; triangle < end; triangle++) {
+            auto corner = &indices[triangle * 3];
+            glm::vec3 p[3] = {positions[corner[0]], positions[corner[1]], positions[corner[2]]};
+            auto normal = normalizeOr(glm::cross(p[1] - p[0], p[2] - p[0]), glm::vec3{0.f});
+            for (int k = 0; k < 3; k++) {
+                contributions[triangle * 3 + k] = normal * angleBetween(p[(k + 1) % 3] - p[k], p[(k + 2) % 3] - p[k]);
+            }
+        }
+    });
+
+    // Every vertex's own normal, from the triangles that use it. Zero for vertices without any triangle of non-zero
+    // area, those point up unless they take the normal of their position.
+    constexpr glm::vec3 up{0.f, 1.f, 0.f};
+    auto rows = buildCornerRows(indices, {}, vertex_count);
+    std::vector<glm::vec3> normals(vertex_count);
+    forEachChunk(jobs, vertex_count, NORMAL_CHUNK, [&](size_t begin, size_t end) {
+        for (size_t vertex = begin; vertex < end; vertex++) {
+            glm::vec3 sum{0.f};
+            for (auto i = rows.first[vertex]; i < rows.first[vertex + 1]; i++) {
+                sum += contributions[rows.corners[i]];
+            }
+            normals[vertex] = normalizeOr(sum, by_position ? glm::vec3{0.f} : up);
+        }
+    });
+    if (!by_position) {
+        return normals;
+    }
+
+    // Vertices at one position also take the triangles of the others that face within crease_angle of their own normal
+    size_t group_count;
+    auto group = positionGroups(positions, group_count, jobs);
+    auto group_rows = buildCornerRows(indices, group, group_count);
+    auto min_cos = std::cos(crease_angle);
+    std::vector<glm::vec3> smooth(vertex_count);
+    forEachChunk(jobs, vertex_count, NORMAL_CHUNK, [&](size_t begin, size_t end) {
+        for (size_t vertex = begin; vertex < end; vertex++) {
+            glm::vec3 sum{0.f};
+            auto g = group[vertex];
+            for (auto i = group_rows.first[g]; i < group_rows.first[g + 1]; i++) {
+                auto corner = group_rows.corners[i];
+                auto& contribution = contributions[corner];
+                if (indices[corner] == vertex || normals[vertex] == glm::vec3{0.f} ||
+                    glm::dot(normalizeOr(contribution, glm::vec3{0.f}), normals[vertex]) >= min_cos) {
+                    sum += contribution;
+                }
+            }
+            smooth[vertex] = normalizeOr(sum, up);
+        }
+    });
+    return smooth;
+}
+
+// Tangents
+std::vector<glm::vec4> computeTangents(std::span<const uint> indices, std::span<const glm::vec3> positions,
+                                       std::span<const glm::vec3> normals, std::span<const glm::vec2> uvs,
+                                       JobSystem* jobs) {
+    assert(indices.size() % 3 == 0);
+    assert(normals.size() >= positions.size() && uvs.size() >= positions.size());
+    auto vertex_count = positions.size();
+    if (vertex_count == 0) {
+        return {};
+    }
+
+    struct Contribution {
+        glm::vec3 tangent;
+        glm::vec3 bitangent;
+    };
+    std::vector<Contribution> contributions(indices.size());
+    forEachChunk(jobs, indices.size() / 3, NORMAL_CHUNK, [&](size_t begin, size_t end) {
+        for (size_t triangle = begin; triangle < end; triangle++) {
+            auto corner = &indices[triangle * 3];
+            glm::vec3 p[3] = {positions[corner[0]], positions[corner[1]], positions[corner[2]]};
+            auto e1 = p[1] - p[0], e2 = p[2] - p[0];
+            auto d1 = uvs[corner[1]] - uvs[corner[0]], d2 = uvs[corner[2]] - uvs[corner[0]];
+
+            // Directions in which u and v grow across the triangle; triangles without a UV area add nothing
+            auto area = d1.x * d2.y - d2.x * d1.y;
+            if (area == 0.f || !std::isfinite(area)) {
+                for (int k = 0; k < 3; k++) {
+                    contributions[triangle * 3 + k] = {glm::vec3{0.f}, glm::vec3{0.f}};
+                }
+                continue;
+            }
+            auto s = (e1 * d2.y - e2 * d1.y) / area;
+            auto t = (e2 * d1.x - e1 * d2.x) / area;
+
+            for (int k = 0; k < 3; k++) {
+                auto& n = normals[corner[k]];
+                auto angle = angleBetween(p[(k + 1) % 3] - p[k], p[(k + 2) % 3] - p[k]);
+                contributions[triangle * 3 + k] = {normalizeOr(s - n * glm::dot(n, s), glm::vec3{0.f}) * angle,
+                                                   normalizeOr(t - n * glm::dot(n, t), glm::vec3{0.f}) * angle};
+            }
+        }
+    });
+
+    // Rejects the components along the normal and takes the bitangent's side as the sign
+    auto orthogonalize = [&](size_t vertex, const Contribution& sum) {
+        auto& n = normals[vertex];
+        auto tangent = normalizeOr(sum.tangent - n * glm::dot(n, sum.tangent), anyPerpendicular(n));
+        auto sign = glm::dot(glm::cross(n, tangent), sum.bitangent) < 0.f ? -1.f : 1.f;
+        return glm::vec4{tangent, sign};
+    };
+    auto sumRow = [&](const CornerRows& rows, size_t row, auto&& include) {
+        Contribution sum{glm::vec3{0.f}, glm::vec3{0.f}};
+        for (auto i = rows.first[row]; i < rows.first[row + 1]; i++) {
+            auto corner = rows.corners[i];
+            if (include(indices[corner])) {
+                sum.tangent += contributions[corner].tangent;
+                sum.bitangent += contributions[corner].bitangent;
+            }
+        }
+        return sum;
+    };
+
+    // Every vertex's own tangent, from the triangles that use it
+    auto rows = buildCornerRows(indices, {}, vertex_count);
+    std::vector<glm::vec4> own(vertex_count);
+    forEachChunk(jobs, vertex_count, NORMAL_CHUNK, [&](size_t begin, size_t end) {
+        for (size_t vertex = begin; vertex < end; vertex++) {
+            own[vertex] = orthogonalize(vertex, sumRow(rows, vertex, [](uint) { return true; }));
+        }
+    });
+
+    // Grouped like the normals: vertices at one position that ended up with the same normal and handedness, such as
+    // the two sides of a UV seam, share their triangles
+    size_t group_count;
+    auto group = positionGroups(positions, group_count, jobs);
+    auto group_rows = buildCornerRows(indices, group, group_count);
+    std::vector<glm::vec4> tangents(vertex_count);
+    forEachChunk(jobs, vertex_count, NORMAL_CHUNK, [&](size_t begin, size_t end) {
+        for (size_t vertex = begin; vertex < end; vertex++) {
+            auto sum = sumRow(group_rows, group[vertex], [&](uint other) {
+                return other == vertex || (normals[other] == normals[vertex] && own[other].w == own[vertex].w);
+            });
+            tangents[vertex] = orthogonalize(vertex, sum);
+        }
+    });
+    return tangents;
+}
+
+}; // namespace Engine
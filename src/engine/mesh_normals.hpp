@@ -0,0 +1,32 @@
+#pragma once
+
+#include "engine/jobs.hpp"
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <span>
+#include <sys/types.h>
+#include <vector>
+
+namespace Engine {
+
+// Triangles meeting at a larger angle keep a hard edge between them when normals are smoothed by position
+constexpr float DEFAULT_CREASE_ANGLE = 1.04719755f; // 60 degrees
+
+// Per vertex normals of a triangle list, the sum of the normals of the triangles around the vertex weighted by the
+// angle they make at it. With by_position, a vertex also takes the triangles of the other vertices at exactly the same
+// position whose face normals are within crease_angle of its own, so vertices split for UV seams are shaded as one
+// while those split for hard edges, like a box's corners, stay apart.
+std::vector<glm::vec3> computeNormals(std::span<const uint> indices, std::span<const glm::vec3> positions,
+                                      bool by_position = true, float crease_angle = DEFAULT_CREASE_ANGLE,
+                                      JobSystem* jobs = nullptr);
+
+// Per vertex tangents of a triangle list following MikkTSpace: the UV derivatives of every triangle are projected onto
+// each corner's normal plane, weighted by the corner angle and summed per vertex. w is the sign of the bitangent, to be
+// rebuilt in the shader as w * cross(normal, tangent). Vertices at the same position with equal normals and handedness
+// share one tangent, the way computeNormals groups them. Unlike MikkTSpace, vertices whose triangles disagree on the
+// handedness are not split.
+std::vector<glm::vec4> computeTangents(std::span<const uint> indices, std::span<const glm::vec3> positions,
+                                       std::span<const glm::vec3> normals, std::span<const glm::vec2> uvs,
+                                       JobSystem* jobs = nullptr);
+
+}; // namespace Engine
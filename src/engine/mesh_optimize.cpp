@@ -0,0 +1,304 @@
+#include "engine/mesh_optimize.hpp"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace Engine {
+
+constexpr uint NO_INDEX = std::numeric_limits<uint>::max();
+
+// Analysis
+VertexCacheStats analyzeVertexCache(std::span<const uint> indices, size_t vertex_count, size_t cache_size) {
+    assert(indices.size() % 3 == 0);
+
+    // A vertex is in the FIFO while fewer than cache_size misses happened after it was loaded
+    std::vector<size_t> loaded_at(vertex_count, 0);
+    std::vector<bool> used(vertex_count, false);
+    size_t misses = 0;
+    size_t used_count = 0;
+
+    for (auto index : indices) {
+        if (!used[index]) {
+            used[index] = true;
+            used_count++;
+        }
+        if (loaded_at[index] == 0 || misses - loaded_at[index] >= cache_size) {
+            misses++;
+            loaded_at[index] = misses;
+        }
+    }
+
+    auto triangles = indices.size() / 3;
+    return {
+        misses,
+        triangles ? static_cast<float>(misses) / triangles : 0.f,
+        used_count ? static_cast<float>(misses) / used_count : 0.f,
+    };
+}
+
+VertexFetchStats analyzeVertexFetch(std::span<const uint> indices, size_t vertex_count, size_t vertex_size) {
+    // Direct mapped cache of 16 KiB, roughly the size of a GPU's vertex fetch cache
+    constexpr size_t LINES = 256;
+    std::array<size_t, LINES> cached;
+    cached.fill(std::numeric_limits<size_t>::max());
+
+    std::vector<bool> used(vertex_count, false);
+    size_t used_count = 0;
+    size_t fetched = 0;
+
+    for (auto index : indices) {
+        if (!used[index]) {
+            used[index] = true;
+            used_count++;
+        }
+
+        auto first_line = index * vertex_size / VERTEX_FETCH_LINE;
+        auto last_line = ((index + 1) * vertex_size - 1) / VERTEX_FETCH_LINE;
+        for (auto line = first_line; line <= last_line; line++) {
+            auto& slot = cached[line % LINES];
+            if (slot != line) {
+                slot = line;
+                fetched += VERTEX_FETCH_LINE;
+            }
+        }
+    }
+
+    auto used_bytes = used_count * vertex_size;
+    return {fetched, used_bytes ? static_cast<float>(fetched) / used_bytes : 0.f};
+}
+
+// Vertex cache optimization, scores as in Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+constexpr size_t FORSYTH_CACHE_SIZE = 32;
+
+static float forsythScore(size_t cache_position, size_t remaining_valence) {
+    if (remaining_valence == 0) {
+        return -1.f;
+    }
+
+    float score = 0.f;
+    if (cache_position < 3) {
+        // The last triangle's vertices get a fixed score so that it is not simply repeated in strip order
+        score = 0.75f;
+    } else if (cache_position < FORSYTH_CACHE_SIZE) {
+        score = std::pow(1.f - (cache_position - 3.f) / (FORSYTH_CACHE_SIZE - 3.f), 1.5f);
+    }
+
+    // Vertices with few triangles left are preferred, to finish them off and free their cache slot
+    return score + 2.f / std::sqrt(static_cast<float>(remaining_valence));
+}
+
+void optimizeVertexCache(std::span<uint> indices, size_t vertex_count) {
+    assert(indices.size() % 3 == 0);
+    auto triangle_count = indices.size() / 3;
+    if (triangle_count == 0) {
+        return;
+    }
+
+    // Triangles of every vertex, in compressed rows
+    std::vector<uint> first_triangle(vertex_count + 1, 0);
+    for (auto index : indices) {
+        first_triangle[index + 1]++;
+    }
+    std::partial_sum(first_triangle.begin(), first_triangle.end(), first_triangle.begin());
+
+    std::vector<uint> vertex_triangles(indices.size());
+    std::vector<uint> remaining(vertex_count, 0);
+    for (size_t i = 0; i < indices.size(); i++) {
+        auto vertex = indices[i];
+        vertex_triangles[first_triangle[vertex] + remaining[vertex]++] = static_cast<uint>(i / 3);
+    }
+
+    std::vector<float> vertex_score(vertex_count);
+    for (size_t vertex = 0; vertex < vertex_count; vertex++) {
+        vertex_score[vertex] = forsythScore(FORSYTH_CACHE_SIZE, remaining[vertex]);
+    }
+
+    std::vector<bool> emitted(triangle_count, false);
+
+    std::vector<uint> result;
+    result.reserve(indices.size());
+
+    std::vector<uint> cache;
+    std::vector<uint> next_cache;
+    cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    next_cache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+    size_t scan_cursor = 0;
+    auto best = static_cast<uint>(0);
+
+    while (best != NO_INDEX) {
+        emitted[best] = true;
+        auto t = &indices[best * 3];
+
+        // Remove the triangle from its vertices' lists of remaining triangles
+        for (int k = 0; k < 3; k++) {
+            auto vertex = t[k];
+            result.push_back(vertex);
+
+            auto begin = vertex_triangles.begin() + first_triangle[vertex];
+            auto end = begin + remaining[vertex];
+            std::iter_swap(std::find(begin, end, best), end - 1);
+            remaining[vertex]--;
+        }
+
+        // The triangle's vertices move to the front of the LRU cache
+        next_cache.assign(t, t + 3);
+        for (auto vertex : cache) {
+            if (vertex != t[0] && vertex != t[1] && vertex != t[2]) {
+                next_cache.push_back(vertex);
+            }
+        }
+        std::swap(cache, next_cache);
+
+        // Rescore vertices in the cache, and the ones that just fell out of it
+        for (size_t i = 0; i < cache.size(); i++) {
+            vertex_score[cache[i]] = forsythScore(i, remaining[cache[i]]);
+        }
+
+        // Their triangles are the candidates for the next one
+        float best_score = -1.f;
+        best = NO_INDEX;
+        for (size_t i = 0; i < cache.size(); i++) {
+            auto vertex = cache[i];
+            auto begin = first_triangle[vertex];
+            for (auto j = begin; j < begin + remaining[vertex]; j++) {
+                auto triangle = vertex_triangles[j];
+                auto u = &indices[triangle * 3];
+                auto score = vertex_score[u[0]] + vertex_score[u[1]] + vertex_score[u[2]];
+                if (score > best_score) {
+                    best_score = score;
+                    best = triangle;
+                }
+            }
+        }
+        cache.resize(std::min(cache.size(), FORSYTH_CACHE_SIZE));
+
+        // Nothing adjacent to the cache is left, continue with the next unemitted triangle in input order
+        if (best == NO_INDEX) {
+            while (scan_cursor < triangle_count && emitted[scan_cursor]) {
+                scan_cursor++;
+            }
+            if (scan_cursor < triangle_count) {
+                best = static_cast<uint>(scan_cursor);
+            }
+        }
+    }
+
+    std::ranges::copy(result, indices.begin());
+}
+
+// Overdraw optimization
+void optimizeOverdraw(std::span<uint> indices, std::span<const glm::vec3> positions, float threshold) {
+    assert(indices.size() % 3 == 0);
+    auto triangle_count = indices.size() / 3;
+    if (triangle_count == 0) {
+        return;
+    }
+
+    // Split into clusters at the triangles that miss the cache on all three vertices, where the cache optimizer
+    // started a new region; reordering whole clusters leaves the cache behaviour inside them untouched
+    std::vector<size_t> cluster_starts;
+    {
+        std::vector<size_t> loaded_at(positions.size(), 0);
+        size_t misses = 0;
+        for (size_t triangle = 0; triangle < triangle_count; triangle++) {
+            int triangle_misses = 0;
+            for (int k = 0; k < 3; k++) {
+                auto vertex = indices[triangle * 3 + k];
+                if (loaded_at[vertex] == 0 || misses - loaded_at[vertex] >= VERTEX_CACHE_SIZE) {
+                    misses++;
+                    loaded_at[vertex] = misses;
+                    triangle_misses++;
+                }
+            }
+            if (triangle == 0 || triangle_misses == 3) {
+                cluster_starts.push_back(triangle);
+            }
+        }
+    }
+    cluster_starts.push_back(triangle_count);
+    auto cluster_count = cluster_starts.size() - 1;
+    if (cluster_count < 2) {
+        return;
+    }
+
+    // Area weighted centroid of the mesh
+    glm::vec3 mesh_centroid{0.f};
+    float mesh_area = 0.f;
+    for (size_t triangle = 0; triangle < triangle_count; triangle++) {
+        auto& a = positions[indices[triangle * 3]];
+        auto& b = positions[indices[triangle * 3 + 1]];
+        auto& c = positions[indices[triangle * 3 + 2]];
+        auto area = glm::length(glm::cross(b - a, c - a));
+        mesh_centroid += area * (a + b + c) / 3.f;
+        mesh_area += area;
+    }
+    if (mesh_area > 0.f) {
+        mesh_centroid /= mesh_area;
+    }
+
+    // Clusters facing away from the centroid occlude the rest of the mesh and are drawn first
+    std::vector<float> sort_keys(cluster_count);
+    for (size_t cluster = 0; cluster < cluster_count; cluster++) {
+        glm::vec3 centroid{0.f};
+        glm::vec3 normal{0.f};
+        float area = 0.f;
+        for (auto triangle = cluster_starts[cluster]; triangle < cluster_starts[cluster + 1]; triangle++) {
+            auto& a = positions[indices[triangle * 3]];
+            auto& b = positions[indices[triangle * 3 + 1]];
+            auto& c = positions[indices[triangle * 3 + 2]];
+            auto n = glm::cross(b - a, c - a);
+            auto triangle_area = glm::length(n);
+            centroid += triangle_area * (a + b + c) / 3.f;
+            normal += n;
+            area += triangle_area;
+        }
+        if (area > 0.f) {
+            centroid /= area;
+        }
+        auto length = glm::length(normal);
+        sort_keys[cluster] = length > 0.f ? glm::dot(centroid - mesh_centroid, normal / length) : 0.f;
+    }
+
+    std::vector<size_t> order(cluster_count);
+    std::iota(order.begin(), order.end(), 0);
+    std::ranges::stable_sort(order, std::greater{}, [&](size_t cluster) { return sort_keys[cluster]; });
+
+    std::vector<uint> result;
+    result.reserve(indices.size());
+    for (auto cluster : order) {
+        result.insert(result.end(), indices.begin() + cluster_starts[cluster] * 3,
+                      indices.begin() + cluster_starts[cluster + 1] * 3);
+    }
+
+    auto before = analyzeVertexCache(indices, positions.size()).acmr;
+    auto after = analyzeVertexCache(result, positions.size()).acmr;
+    if (after <= before * threshold) {
+        std::ranges::copy(result, indices.begin());
+    }
+}
+
+// Vertex fetch optimization
+std::vector<uint> optimizeVertexFetchRemap(std::span<uint> indices, size_t vertex_count) {
+    std::vector<uint> remap(vertex_count, NO_INDEX);
+    uint next = 0;
+
+    for (auto& index : indices) {
+        if (remap[index] == NO_INDEX) {
+            remap[index] = next++;
+        }
+        index = remap[index];
+    }
+
+    for (auto& target : remap) {
+        if (target == NO_INDEX) {
+            target = next++;
+        }
+    }
+    return remap;
+}
+
+}; // namespace Engine
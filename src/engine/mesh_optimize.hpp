@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <span>
+#include <sys/types.h>
+#include <vector>
+
+namespace Engine {
+
+constexpr size_t VERTEX_CACHE_SIZE = 16; // FIFO size used for the ACMR / ATVR estimates
+constexpr size_t VERTEX_FETCH_LINE = 64; // bytes per cache line in the vertex fetch estimate
+
+struct VertexCacheStats {
+    size_t vertices_transformed;
+    float acmr; // average cache miss ratio, transformed vertices per triangle (0.5 at best, 3 at worst)
+    float atvr; // average transformed vertex ratio, transformed vertices per used vertex (1 at best)
+};
+
+struct VertexFetchStats {
+    size_t bytes_fetched;
+    float overfetch; // bytes fetched per byte of used vertex data (1 at best)
+};
+
+// Simulates a FIFO post-transform cache over a triangle list
+VertexCacheStats analyzeVertexCache(std::span<const uint> indices, size_t vertex_count,
+                                    size_t cache_size = VERTEX_CACHE_SIZE);
+
+// Simulates fetching vertex_size byte vertices through a small cache of VERTEX_FETCH_LINE byte lines
+VertexFetchStats analyzeVertexFetch(std::span<const uint> indices, size_t vertex_count, size_t vertex_size);
+
+// Reorders the triangles of a triangle list for the post-transform vertex cache (Forsyth's linear-speed algorithm)
+void optimizeVertexCache(std::span<uint> indices, size_t vertex_count);
+
+// Reorders clusters of triangles so that outward facing ones come first, which lets early depth testing reject more
+// of the triangles drawn later. Expects a cache optimized triangle list, whose clusters it keeps intact; the new order
+// is dropped if it raises the ACMR by more than threshold.
+void optimizeOverdraw(std::span<uint> indices, std::span<const glm::vec3> positions, float threshold = 1.05f);
+
+// Computes a vertex order in which the vertices are first referenced by indices, and rewrites indices to it.
+// Returns the new position of every old vertex; unreferenced vertices are moved to the end.
+std::vector<uint> optimizeVertexFetchRemap(std::span<uint> indices, size_t vertex_count);
+
+}; // namespace Engine
@@ -0,0 +1,279 @@
+#include "engine/mesh_simplify.hpp"
+#include "engine/mesh_weld.hpp"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <numeric>
+
+namespace Engine {
+
+constexpr size_t MAX_SIMPLIFY_PASSES = 100;
+
+// Symmetric 4x4 matrix accumulating the squared distances to a set of planes, weighted by triangle area
+struct Quadric {
+    std::array<double, 10> a{};
+    double weight = 0.0;
+
+    void addPlane(const glm::dvec3& normal, double distance, double weight) {
+        double p[4] = {normal.x, normal.y, normal.z, distance};
+        size_t k = 0;
+        for (int i = 0; i < 4; i++) {
+            for (int j = i; j < 4; j++) {
+                a[k++] += weight * p[i] * p[j];
+            }
+        }
+        this->weight += weight;
+    }
+
+    Quadric& operator+=(const Quadric& other) {
+        for (size_t k = 0; k < a.size(); k++) {
+            a[k] += other.a[k];
+        }
+        weight += other.weight;
+        return *this;
+    }
+
+    // Mean squared distance of v to the planes
+    double error(const glm::vec3& v) const {
+        double p[4] = {v.x, v.y, v.z, 1.0};
+        double result = 0.0;
+        size_t k = 0;
+        for (int i = 0; i < 4; i++) {
+            for (int j = i; j < 4; j++) {
+                result += (i == j ? 1.0 : 2.0) * a[k++] * p[i] * p[j];
+            }
+        }
+        return weight > 0.0 ? std::max(result, 0.0) / weight : 0.0;
+    }
+};
+
+struct Collapse {
+    uint from;
+    uint to;
+    double cost;
+};
+
+// Vertices that must stay where they are: attribute seams and open borders
+static std::vector<bool> findLockedVertices(std::span<const uint> indices, std::span<const glm::vec3> positions) {
+    auto vertex_count = positions.size();
+    if (vertex_count == 0) {
+        return {};
+    }
+
+    // Vertices at bit-identical positions share one position id
+    size_t position_count;
+    WeldStream stream{&positions[0].x, 3};
+    auto position_id = weldVertices({&stream, 1}, vertex_count, 0.f, position_count);
+    std::vector<uint> vertices_at(position_count, 0);
+    for (auto id : position_id) {
+        vertices_at[id]++;
+    }
+
+    // Triangles around every position, in compressed rows
+    auto corner = [&](size_t triangle, size_t k) { return position_id[indices[triangle * 3 + k % 3]]; };
+    std::vector<uint> first(position_count + 1, 0);
+    for (auto index : indices) {
+        first[position_id[index] + 1]++;
+    }
+    std::partial_sum(first.begin(), first.end(), first.begin());
+    std::vector<uint> around(indices.size());
+    {
+        std::vector<uint> cursor(first.begin(), first.end() - 1);
+        for (size_t i = 0; i < indices.size(); i++) {
+            around[cursor[position_id[indices[i]]]++] = static_cast<uint>(i / 3);
+        }
+    }
+
+    // A directed edge without its twin is an open border, in terms of positions so that seams do not count
+    std::vector<bool> border(position_count, false);
+    for (size_t triangle = 0; triangle < indices.size() / 3; triangle++) {
+        for (size_t k = 0; k < 3; k++) {
+            auto a = corner(triangle, k), b = corner(triangle, k + 1);
+            bool twin = false;
+            for (auto i = first[b]; i < first[b + 1] && !twin; i++) {
+                for (size_t m = 0; m < 3 && !twin; m++) {
+                    twin = corner(around[i], m) == b && corner(around[i], m + 1) == a;
+                }
+            }
+            if (!twin) {
+                border[a] = border[b] = true;
+            }
+        }
+    }
+
+    std::vector<bool> locked(vertex_count, false);
+    for (uint vertex = 0; vertex < vertex_count; vertex++) {
+        auto id = position_id[vertex];
+        locked[vertex] = vertices_at[id] > 1 || border[id];
+    }
+    return locked;
+}
+
+static glm::vec3 triangleNormal(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+    return glm::cross(b - a, c - a);
+}
+
+std::vector<uint> simplifyMesh(std::span<const uint> indices, std::span<const glm::vec3> positions,
+                               size_t target_index_count, float target_error, float* result_error) {
+    assert(indices.size() % 3 == 0);
+    auto vertex_count = positions.size();
+    std::vector<uint> result(indices.begin(), indices.end());
+
+    glm::vec3 min{std::numeric_limits<float>::max()};
+    glm::vec3 max{std::numeric_limits<float>::lowest()};
+    for (auto index : indices) {
+        min = glm::min(min, positions[index]);
+        max = glm::max(max, positions[index]);
+    }
+    double scale = indices.empty() ? 0.0 : glm::length(max - min);
+    double error_limit = target_error * scale;
+    double max_cost = 0.0;
+
+    auto locked = findLockedVertices(indices, positions);
+
+    std::vector<Quadric> quadrics(vertex_count);
+    for (size_t i = 0; i < result.size(); i += 3) {
+        auto& a = positions[result[i]];
+        auto& b = positions[result[i + 1]];
+        auto& c = positions[result[i + 2]];
+        glm::dvec3 normal = triangleNormal(a, b, c);
+        auto area = glm::length(normal);
+        if (area == 0.0) {
+            continue;
+        }
+        normal /= area;
+        auto distance = -glm::dot(normal, glm::dvec3{a});
+        for (int k = 0; k < 3; k++) {
+            quadrics[result[i + k]].addPlane(normal, distance, area);
+        }
+    }
+
+    std::vector<uint> first_triangle(vertex_count + 1);
+    std::vector<uint> vertex_triangles;
+    std::vector<Collapse> best(vertex_count);
+    std::vector<Collapse> collapses;
+    std::vector<uint> remap(vertex_count);
+    std::vector<bool> touched(vertex_count);
+
+    for (size_t pass = 0; pass < MAX_SIMPLIFY_PASSES && result.size() > target_index_count; pass++) {
+        // Triangles of every vertex, in compressed rows
+        std::ranges::fill(first_triangle, 0);
+        for (auto index : result) {
+            first_triangle[index + 1]++;
+        }
+        for (size_t vertex = 0; vertex < vertex_count; vertex++) {
+            first_triangle[vertex + 1] += first_triangle[vertex];
+        }
+        vertex_triangles.resize(result.size());
+        {
+            auto cursor = first_triangle;
+            for (size_t i = 0; i < result.size(); i++) {
+                vertex_triangles[cursor[result[i]]++] = static_cast<uint>(i / 3);
+            }
+        }
+
+        // Every unlocked endpoint of an edge may be collapsed onto the other one. Only the cheapest collapse of each
+        // vertex is kept: a pass touches the neighbourhood of every collapse it makes, so a vertex whose best
+        // neighbour is taken rarely gets another chance in the same pass anyway, and sorting stays small.
+        std::ranges::fill(best, Collapse{0, 0, std::numeric_limits<double>::infinity()});
+        for (size_t i = 0; i < result.size(); i += 3) {
+            for (int k = 0; k < 3; k++) {
+                auto from = result[i + k];
+                auto to = result[i + (k + 1) % 3];
+                for (auto [a, b] : {std::pair{from, to}, std::pair{to, from}}) {
+                    if (!locked[a]) {
+                        auto quadric = quadrics[a];
+                        quadric += quadrics[b];
+                        auto cost = quadric.error(positions[b]);
+                        if (cost < best[a].cost) {
+                            best[a] = {a, b, cost};
+                        }
+                    }
+                }
+            }
+        }
+        collapses.clear();
+        std::ranges::copy_if(best, std::back_inserter(collapses), [](const Collapse& c) { return std::isfinite(c.cost); });
+        if (collapses.empty()) {
+            break;
+        }
+        std::ranges::sort(collapses, {}, &Collapse::cost);
+
+        // Collapses in one pass must not share any triangle, so each flip test sees the final geometry
+        std::iota(remap.begin(), remap.end(), 0);
+        std::fill(touched.begin(), touched.end(), false);
+        size_t triangles_to_remove = (result.size() - target_index_count) / 3 + 1;
+        size_t removed = 0;
+
+        for (auto& collapse : collapses) {
+            if (collapse.cost > error_limit * error_limit || removed >= triangles_to_remove) {
+                break;
+            }
+            if (touched[collapse.from] || touched[collapse.to]) {
+                continue;
+            }
+
+            auto begin = first_triangle[collapse.from];
+            auto end = first_triangle[collapse.from + 1];
+            bool flips = false;
+            size_t collapsed = 0;
+            for (auto j = begin; j < end && !flips; j++) {
+                auto t = &result[vertex_triangles[j] * 3];
+                if (t[0] == collapse.to || t[1] == collapse.to || t[2] == collapse.to) {
+                    collapsed++;
+                    continue;
+                }
+
+                glm::vec3 before[3], after[3];
+                for (int k = 0; k < 3; k++) {
+                    before[k] = positions[t[k]];
+                    after[k] = t[k] == collapse.from ? positions[collapse.to] : positions[t[k]];
+                }
+                auto n0 = triangleNormal(before[0], before[1], before[2]);
+                auto n1 = triangleNormal(after[0], after[1], after[2]);
+                flips = glm::dot(n0, n1) <= 0.f;
+            }
+            if (flips) {
+                continue;
+            }
+
+            for (auto j = begin; j < end; j++) {
+                auto t = &result[vertex_triangles[j] * 3];
+                touched[t[0]] = touched[t[1]] = touched[t[2]] = true;
+            }
+
+            remap[collapse.from] = collapse.to;
+            quadrics[collapse.to] += quadrics[collapse.from];
+            max_cost = std::max(max_cost, collapse.cost);
+            removed += collapsed;
+        }
+
+        if (removed == 0) {
+            break;
+        }
+
+        size_t write = 0;
+        for (size_t i = 0; i < result.size(); i += 3) {
+            auto a = remap[result[i]];
+            auto b = remap[result[i + 1]];
+            auto c = remap[result[i + 2]];
+            if (a != b && b != c && c != a) {
+                result[write++] = a;
+                result[write++] = b;
+                result[write++] = c;
+            }
+        }
+        result.resize(write);
+    }
+
+    if (result_error) {
+        *result_error = scale > 0.0 ? static_cast<float>(std::sqrt(max_cost) / scale) : 0.f;
+    }
+    return result;
+}
+
+}; // namespace Engine
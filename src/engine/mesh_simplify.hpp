@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <span>
+#include <sys/types.h>
+#include <vector>
+
+namespace Engine {
+
+// Simplifies a triangle list by quadric error edge collapses. Vertices are only ever merged into existing vertices, so
+// the result indexes the same vertex buffer. Vertices on open borders and attribute seams (several vertices at one
+// position) are never moved, which keeps the outline and the UV / normal seams intact.
+//
+// Collapses stop once at most target_index_count indices are left or the next collapse would move the surface by more
+// than target_error, relative to the mesh's bounding box diagonal. The error actually reached is stored in
+// result_error when given.
+std::vector<uint> simplifyMesh(std::span<const uint> indices, std::span<const glm::vec3> positions,
+                               size_t target_index_count, float target_error, float* result_error = nullptr);
+
+}; // namespace Engine
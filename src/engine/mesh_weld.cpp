@@ -0,0 +1,132 @@
+#include "engine/mesh_weld.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+
+namespace Engine {
+
+constexpr size_t WELD_CHUNK = 1 << 14; // vertices per job
+
+static uint32_t weldKey(float value, float epsilon) {
+    if (epsilon > 0.f && !std::isnan(value)) {
+        auto cell = std::floor(static_cast<double>(value) / epsilon + 0.5);
+        cell = std::clamp<double>(cell, std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::max());
+        return static_cast<uint32_t>(static_cast<int32_t>(cell));
+    }
+    return value == 0.f ? 0u : std::bit_cast<uint32_t>(value);
+}
+
+// MurmurHash3's block mix and finalizer over the keys of every component of a vertex
+static uint32_t hashVertex(std::span<const WeldStream> streams, size_t vertex, float epsilon) {
+    uint32_t hash = 0;
+    for (auto& stream : streams) {
+        for (size_t c = 0; c < stream.components; c++) {
+            auto k = weldKey(stream.data[vertex * stream.components + c], epsilon) * 0xcc9e2d51u;
+            k = std::rotl(k, 15) * 0x1b873593u;
+            hash = std::rotl(hash ^ k, 13) * 5 + 0xe6546b64u;
+        }
+    }
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+std::vector<uint> weldVertices(std::span<const WeldStream> streams, size_t vertex_count, float epsilon,
+                               size_t& unique_count, JobSystem* jobs) {
+    assert(!streams.empty() && "Welding needs at least one stream");
+
+    // Keys are cheap to recompute, storing them would double the memory traffic for large inputs
+    std::vector<uint32_t> hashes(vertex_count);
+    forEachChunk(jobs, vertex_count, WELD_CHUNK, [&](size_t begin, size_t end) {
+        for (size_t vertex = begin; vertex < end; vertex++) {
+            hashes[vertex] = hashVertex(streams, vertex, epsilon);
+        }
+    });
+
+    auto equal = [&](size_t a, size_t b) {
+        if (hashes[a] != hashes[b]) {
+            return false;
+        }
+        for (auto& stream : streams) {
+            for (size_t c = 0; c < stream.components; c++) {
+                if (weldKey(stream.data[a * stream.components + c], epsilon) !=
+                    weldKey(stream.data[b * stream.components + c], epsilon)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    };
+
+    // Linear probing in a table at most half full. A slot holds a vertex plus one, 0 being empty, and once taken only
+    // ever holds vertices of one group: inserting a smaller vertex of the group replaces the one held, so every slot
+    // ends up with the first vertex of its group whatever order the inserts ran in.
+    auto mask = std::bit_ceil(std::max<size_t>(vertex_count * 2, 16)) - 1;
+    std::vector<std::atomic<uint>> table(mask + 1);
+    std::vector<uint> group(vertex_count); // the vertex's slot, then the first vertex of its group
+    forEachChunk(jobs, vertex_count, WELD_CHUNK, [&](size_t begin, size_t end) {
+        for (size_t vertex = begin; vertex < end; vertex++) {
+            auto slot = hashes[vertex] & mask;
+            auto inserted = static_cast<uint>(vertex + 1);
+            while (true) {
+                auto held = table[slot].load(std::memory_order_relaxed);
+                if (held == 0 && table[slot].compare_exchange_strong(held, inserted, std::memory_order_relaxed)) {
+                    break;
+                }
+                // held is now whichever vertex owns the slot, possibly one that just took it
+                if (equal(held - 1, vertex)) {
+                    while (held > inserted &&
+                           !table[slot].compare_exchange_weak(held, inserted, std::memory_order_relaxed)) {
+                    }
+                    break;
+                }
+                slot = (slot + 1) & mask;
+            }
+            group[vertex] = static_cast<uint>(slot);
+        }
+    });
+
+    // Groups are numbered in order of their first vertex: count them per chunk, then number them from each chunk's
+    // offset, then point the other vertices at their group's number
+    auto chunk_count = (vertex_count + WELD_CHUNK - 1) / WELD_CHUNK;
+    std::vector<size_t> chunk_first(chunk_count + 1, 0);
+    forEachChunk(jobs, vertex_count, WELD_CHUNK, [&](size_t begin, size_t end) {
+        size_t firsts = 0;
+        for (size_t vertex = begin; vertex < end; vertex++) {
+            group[vertex] = table[group[vertex]].load(std::memory_order_relaxed) - 1;
+            firsts += group[vertex] == vertex;
+        }
+        chunk_first[begin / WELD_CHUNK + 1] = firsts;
+    });
+    std::partial_sum(chunk_first.begin(), chunk_first.end(), chunk_first.begin());
+
+    std::vector<uint> remap(vertex_count);
+    forEachChunk(jobs, vertex_count, WELD_CHUNK, [&](size_t begin, size_t end) {
+        auto next = chunk_first[begin / WELD_CHUNK];
+        for (size_t vertex = begin; vertex < end; vertex++) {
+            if (group[vertex] == vertex) {
+                remap[vertex] = static_cast<uint>(next++);
+            }
+        }
+    });
+    forEachChunk(jobs, vertex_count, WELD_CHUNK, [&](size_t begin, size_t end) {
+        for (size_t vertex = begin; vertex < end; vertex++) {
+            if (group[vertex] != vertex) {
+                remap[vertex] = remap[group[vertex]];
+            }
+        }
+    });
+
+    unique_count = chunk_first.back();
+    return remap;
+}
+
+}; // namespace Engine
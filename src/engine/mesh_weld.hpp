@@ -0,0 +1,27 @@
+#pragma once
+
+#include "engine/jobs.hpp"
+#include <cstddef>
+#include <span>
+#include <sys/types.h>
+#include <vector>
+
+namespace Engine {
+
+// One attribute of every vertex, components floats per vertex, tightly packed
+struct WeldStream {
+    const float* data;
+    size_t components;
+};
+
+// Groups the vertices whose components are equal in every stream, with an open addressing hash table. With epsilon 0
+// components have to be bit-identical (0 and -0 count as equal); otherwise they are snapped to multiples of epsilon
+// first, so values closer than epsilon merge unless a multiple lies between them.
+//
+// Returns the new index of every vertex in a compacted order: each group takes the place of its first vertex, and
+// the groups keep their relative order. The number of groups is stored in unique_count. Large inputs are split into
+// jobs when a job system is given; the result does not depend on how they are scheduled.
+std::vector<uint> weldVertices(std::span<const WeldStream> streams, size_t vertex_count, float epsilon,
+                               size_t& unique_count, JobSystem* jobs = nullptr);
+
+}; // namespace Engine
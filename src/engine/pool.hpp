@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace Engine {
+
+// Slab allocator for objects of one type. Objects are constructed in place and never move; released slots go on a
+// free list and are reused first. Every slot has a generation counter that is bumped on release, so handles can tell
+// a live object from a reused slot. Slabs are only freed together with the pool.
+template <typename T> class Pool {
+  public:
+    static constexpr size_t SLAB_SIZE = 256;
+
+    // One pool per type, deliberately leaked so that objects may still be released during static destruction
+    static Pool& instance() {
+        static auto pool = new Pool();
+        return *pool;
+    }
+
+    template <typename... Args> T* create(Args&&... args) {
+        Slot* slot;
+        {
+            std::lock_guard lock{mutex};
+            if (!free_list) {
+                grow(SLAB_SIZE);
+            }
+            slot = free_list;
+            free_list = slot->next_free;
+            live++;
+        }
+
+        return new (slot->storage) T(std::forward<Args>(args)...);
+    }
+
+    void release(T* object) {
+        object->~T();
+
+        auto slot = reinterpret_cast<Slot*>(object);
+        std::lock_guard lock{mutex};
+        slot->generation++;
+        slot->next_free = free_list;
+        free_list = slot;
+        live--;
+    }
+
+    // Makes sure count more objects can be created without touching the system allocator
+    void reserve(size_t count) {
+        std::lock_guard lock{mutex};
+        size_t available = 0;
+        for (auto slot = free_list; slot && available < count; slot = slot->next_free) {
+            available++;
+        }
+        if (available < count) {
+            grow(count - available);
+        }
+    }
+
+    static const uint32_t* generation(const T* object) { return &reinterpret_cast<const Slot*>(object)->generation; }
+
+    size_t size() const { return live; }
+    size_t capacity() const { return total; }
+
+  private:
+    struct Slot {
+        alignas(T) std::byte storage[sizeof(T)]; // must stay the first member, objects are cast back to their slot
+        uint32_t generation = 0;
+        Slot* next_free = nullptr;
+    };
+
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Slot[]>> slabs;
+    Slot* free_list = nullptr;
+    size_t live = 0;
+    size_t total = 0;
+
+    Pool() = default;
+
+    void grow(size_t count) {
+        auto& slab = slabs.emplace_back(std::make_unique<Slot[]>(count));
+        for (size_t i = count; i-- > 0;) {
+            slab[i].next_free = free_list;
+            free_list = &slab[i];
+        }
+        total += count;
+    }
+};
+
+}; // namespace Engine
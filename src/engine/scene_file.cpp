@@ -0,0 +1,273 @@
+#include "engine/scene_file.hpp"
+#include "common.hpp"
+#include <bit>
+#include <fcntl.h>
+#include <fstream>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace Engine {
+
+static_assert(std::endian::native == std::endian::little, "Scene files are read in place and assume little endian");
+
+// Serializable component registry
+struct SerializableRegistry {
+    std::mutex mutex;
+    std::vector<SerializableComponent> components;
+};
+
+static SerializableRegistry& serializableRegistry() {
+    static SerializableRegistry registry;
+    return registry;
+}
+
+void registerSerializable(const SerializableComponent& component) {
+    auto& registry = serializableRegistry();
+    std::lock_guard lock{registry.mutex};
+    for (auto& registered : registry.components) {
+        assert(registered.type != component.type && "Serializable component name registered twice");
+    }
+    registry.components.push_back(component);
+}
+
+static const SerializableComponent* findSerializable(uint64_t type) {
+    auto& registry = serializableRegistry();
+    std::lock_guard lock{registry.mutex};
+    for (auto& component : registry.components) {
+        if (component.type == type) {
+            return &component;
+        }
+    }
+    return nullptr;
+}
+
+static size_t alignUp(size_t offset) {
+    return (offset + SCENE_FILE_ALIGNMENT - 1) / SCENE_FILE_ALIGNMENT * SCENE_FILE_ALIGNMENT;
+}
+
+// Saving
+struct SceneWriter {
+    std::vector<SerializableComponent> serializable;
+
+    std::vector<SceneFileNode> nodes;
+    std::vector<SceneFileComponent> components;
+    std::vector<std::byte> data;
+    std::string strings;
+
+    // Pre-order walk, children in the order they were added, so every parent comes before its children
+    uint32_t write(Node& node, uint32_t parent) {
+        auto index = static_cast<uint32_t>(nodes.size());
+        auto name = node.getName();
+
+        SceneFileNode record{};
+        record.local_transform = node.getLocalTransform();
+        record.parent = parent;
+        record.first_child = SCENE_FILE_NO_NODE;
+        record.next_sibling = SCENE_FILE_NO_NODE;
+        record.name_offset = static_cast<uint32_t>(strings.size());
+        record.name_length = static_cast<uint32_t>(name.size());
+        record.first_component = static_cast<uint32_t>(components.size());
+        strings += name;
+
+        if (auto world = node.getWorld()) {
+            record.flags |= SCENE_NODE_HAS_ENTITY;
+            for (auto& component : serializable) {
+                auto ptr = world->get(node.getEntity(), component.id);
+                if (!ptr) {
+                    continue;
+                }
+                auto offset = alignUp(data.size());
+                data.resize(offset + component.size);
+                std::memcpy(data.data() + offset, ptr, component.size);
+                components.push_back({component.type, offset, component.size, 0});
+                record.component_count++;
+            }
+        }
+        nodes.push_back(record);
+
+        uint32_t previous = SCENE_FILE_NO_NODE;
+        node.forEachChild([&](Node& child) {
+            auto child_index = write(child, index);
+            if (previous == SCENE_FILE_NO_NODE) {
+                nodes[index].first_child = child_index;
+            } else {
+                nodes[previous].next_sibling = child_index;
+            }
+            previous = child_index;
+        });
+        return index;
+    }
+};
+
+bool saveScene(Node& root, const std::string& path) {
+    SceneWriter writer;
+    {
+        auto& registry = serializableRegistry();
+        std::lock_guard lock{registry.mutex};
+        writer.serializable = registry.components;
+    }
+    writer.write(root, SCENE_FILE_NO_NODE);
+    auto& nodes = writer.nodes;
+    auto& components = writer.components;
+    auto& data = writer.data;
+    auto& strings = writer.strings;
+
+    SceneFileHeader header{};
+    header.magic = SCENE_FILE_MAGIC;
+    header.version = SCENE_FILE_VERSION;
+    header.node_count = static_cast<uint32_t>(nodes.size());
+    header.component_count = static_cast<uint32_t>(components.size());
+    header.nodes_offset = alignUp(sizeof(SceneFileHeader));
+    header.components_offset = alignUp(header.nodes_offset + nodes.size() * sizeof(SceneFileNode));
+    header.data_offset = alignUp(header.components_offset + components.size() * sizeof(SceneFileComponent));
+    header.data_size = data.size();
+    header.strings_offset = alignUp(header.data_offset + data.size());
+    header.strings_size = strings.size();
+
+    std::ofstream file{path, std::ios::binary | std::ios::trunc};
+    if (!file) {
+        DBG("Failed to open scene file for writing: " << path);
+        return false;
+    }
+
+    size_t position = 0;
+    auto section = [&](size_t offset, const void* bytes, size_t size) {
+        static constexpr char padding[SCENE_FILE_ALIGNMENT] = {};
+        file.write(padding, static_cast<std::streamsize>(offset - position));
+        file.write(static_cast<const char*>(bytes), static_cast<std::streamsize>(size));
+        position = offset + size;
+    };
+    section(0, &header, sizeof(header));
+    section(header.nodes_offset, nodes.data(), nodes.size() * sizeof(SceneFileNode));
+    section(header.components_offset, components.data(), components.size() * sizeof(SceneFileComponent));
+    section(header.data_offset, data.data(), data.size());
+    section(header.strings_offset, strings.data(), strings.size());
+
+    if (!file) {
+        DBG("Failed to write scene file: " << path);
+        return false;
+    }
+    return true;
+}
+
+// MappedScene implementation
+
+// Every reference a record makes has to stay inside its section, and parents have to come before their children, so
+// that reading and instantiating the scene never needs another check
+static bool recordsAreValid(const SceneFileHeader& header, const SceneFileNode* nodes,
+                            const SceneFileComponent* components) {
+    for (uint32_t i = 0; i < header.component_count; i++) {
+        auto& component = components[i];
+        if (component.data_offset > header.data_size || component.size > header.data_size - component.data_offset) {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < header.node_count; i++) {
+        auto& node = nodes[i];
+        if ((i == 0 ? node.parent != SCENE_FILE_NO_NODE : node.parent >= i) ||
+            uint64_t{node.name_offset} + node.name_length > header.strings_size ||
+            uint64_t{node.first_component} + node.component_count > header.component_count) {
+            return false;
+        }
+    }
+    return true;
+}
+
+MappedScene::MappedScene(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        DBG("Failed to open scene file: " << path);
+        return;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(SceneFileHeader)) {
+        DBG("Scene file is too small: " << path);
+        close(fd);
+        return;
+    }
+
+    length = static_cast<size_t>(info.st_size);
+    mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        DBG("Failed to map scene file: " << path);
+        mapping = nullptr;
+        return;
+    }
+
+    auto base = static_cast<const std::byte*>(mapping);
+    auto candidate = reinterpret_cast<const SceneFileHeader*>(base);
+    if (candidate->magic != SCENE_FILE_MAGIC || candidate->version != SCENE_FILE_VERSION) {
+        DBG("Not a scene file of version " << SCENE_FILE_VERSION << ": " << path);
+        return;
+    }
+
+    auto fits = [&](uint64_t offset, uint64_t size) {
+        return offset % SCENE_FILE_ALIGNMENT == 0 && offset <= length && size <= length - offset;
+    };
+    if (!fits(candidate->nodes_offset, uint64_t{candidate->node_count} * sizeof(SceneFileNode)) ||
+        !fits(candidate->components_offset, uint64_t{candidate->component_count} * sizeof(SceneFileComponent)) ||
+        !fits(candidate->data_offset, candidate->data_size) ||
+        !fits(candidate->strings_offset, candidate->strings_size) || candidate->node_count == 0) {
+        DBG("Scene file sections are out of bounds: " << path);
+        return;
+    }
+
+    auto candidate_nodes = reinterpret_cast<const SceneFileNode*>(base + candidate->nodes_offset);
+    auto candidate_components = reinterpret_cast<const SceneFileComponent*>(base + candidate->components_offset);
+    if (!recordsAreValid(*candidate, candidate_nodes, candidate_components)) {
+        DBG("Scene file records are out of bounds: " << path);
+        return;
+    }
+
+    header = candidate;
+    nodes = candidate_nodes;
+    component_records = candidate_components;
+    data = base + header->data_offset;
+    strings = reinterpret_cast<const char*>(base + header->strings_offset);
+}
+
+MappedScene::~MappedScene() {
+    if (mapping) {
+        munmap(mapping, length);
+    }
+}
+
+void MappedScene::instantiate(Node& into, World* world) const {
+    assert(header && "Scene file is not open");
+
+    std::vector<Node*> created(size());
+    created[0] = &into;
+    Pool<Node>::instance().reserve(size() - 1);
+
+    for (uint32_t i = 0; i < size(); i++) {
+        auto& record = nodes[i];
+        if (i > 0) {
+            created[i] = created[record.parent]->emplace<Node>(std::string{name(i)}).get();
+        }
+
+        auto node = created[i];
+        node->setLocalTransform(record.local_transform);
+
+        if (!world || !(record.flags & SCENE_NODE_HAS_ENTITY)) {
+            continue;
+        }
+        auto entity = world->create();
+        node->setEntity(*world, entity);
+
+        for (auto& component : components(i)) {
+            auto serializable = findSerializable(component.type);
+            if (!serializable || serializable->size != component.size) {
+                DBG("Skipping unknown component " << component.type << " on " << node->getPath());
+                continue;
+            }
+            serializable->load(*world, entity, componentData(component));
+        }
+    }
+}
+
+}; // namespace Engine
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "engine/arch.hpp"
+#include "engine/ecs.hpp"
+#include "engine/hash.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <limits>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace Engine {
+
+// Binary scene files. Everything is little endian and laid out exactly as the structs below, so a mapped file is used
+// in place: sections are found through the offsets in the header and records refer to each other by index.
+//
+//   header | nodes (pre-order, root first) | component records | component data | string table
+//
+// Every section starts at a multiple of SCENE_FILE_ALIGNMENT from the start of the file.
+constexpr uint32_t SCENE_FILE_MAGIC = 0x4353'4c47; // "GLSC"
+constexpr uint32_t SCENE_FILE_VERSION = 1;
+constexpr size_t SCENE_FILE_ALIGNMENT = 16;
+constexpr uint32_t SCENE_FILE_NO_NODE = std::numeric_limits<uint32_t>::max();
+
+struct SceneFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t node_count;
+    uint32_t component_count;
+    uint64_t nodes_offset;
+    uint64_t components_offset;
+    uint64_t data_offset;
+    uint64_t data_size;
+    uint64_t strings_offset;
+    uint64_t strings_size;
+};
+
+enum SceneFileNodeFlags : uint32_t {
+    SCENE_NODE_HAS_ENTITY = 1 << 0,
+};
+
+struct SceneFileNode {
+    glm::mat4 local_transform;
+    uint32_t parent;       // SCENE_FILE_NO_NODE for the root
+    uint32_t first_child;  // SCENE_FILE_NO_NODE for leaves
+    uint32_t next_sibling; // SCENE_FILE_NO_NODE for the last child
+    uint32_t name_offset;  // into the string table
+    uint32_t name_length;
+    uint32_t first_component; // into the component records
+    uint32_t component_count;
+    uint32_t flags;
+};
+
+struct SceneFileComponent {
+    uint64_t type;        // hash of the name the component was registered under
+    uint64_t data_offset; // into the component data, aligned to SCENE_FILE_ALIGNMENT
+    uint32_t size;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(glm::mat4) == 16 * sizeof(float), "glm::mat4 must be tightly packed");
+static_assert(sizeof(SceneFileHeader) % SCENE_FILE_ALIGNMENT == 0);
+static_assert(sizeof(SceneFileNode) % SCENE_FILE_ALIGNMENT == 0);
+
+// Component type that can be stored in scene files. The stable name is what identifies the type across builds,
+// component ids depend on registration order.
+struct SerializableComponent {
+    uint64_t type;
+    ComponentId id;
+    uint32_t size;
+    void (*load)(World& world, Entity entity, const void* data);
+};
+
+void registerSerializable(const SerializableComponent& component);
+
+// Components are stored as their raw bytes, so only trivially copyable types can be registered
+template <typename T> void registerSerializable(std::string_view name) {
+    static_assert(std::is_trivially_copyable_v<T>, "Serializable components must be trivially copyable");
+    registerSerializable({
+        hashFnv1a(name),
+        componentId<T>(),
+        sizeof(T),
+        [](World& world, Entity entity, const void* data) {
+            T component;
+            std::memcpy(&component, data, sizeof(T));
+            world.add<T>(entity, component);
+        },
+    });
+}
+
+// Writes root, its subtree, and the serializable components of the entities the nodes own. Returns false when the
+// file cannot be written.
+bool saveScene(Node& root, const std::string& path);
+
+// Read only memory mapping of a scene file. Opening checks the header, the section bounds and that every record's
+// names, components, data and parent lie within the file; files that fail are rejected. Nodes, names and component
+// data are then read straight from the mapping.
+class MappedScene {
+  public:
+    explicit MappedScene(const std::string& path);
+    ~MappedScene();
+
+    MappedScene(const MappedScene&) = delete;
+    MappedScene& operator=(const MappedScene&) = delete;
+
+    explicit operator bool() const { return header != nullptr; }
+
+    uint32_t size() const { return header->node_count; }
+
+    const SceneFileNode& node(uint32_t index) const { return nodes[index]; }
+    std::string_view name(uint32_t index) const {
+        return {strings + nodes[index].name_offset, nodes[index].name_length};
+    }
+    std::span<const SceneFileComponent> components(uint32_t index) const {
+        return {component_records + nodes[index].first_component, nodes[index].component_count};
+    }
+    const void* componentData(const SceneFileComponent& component) const { return data + component.data_offset; }
+
+    // Builds the stored tree below into: the file's root maps onto into itself (its transform and entity), every
+    // other node is emplaced as a plain Node. Entities are created in world when given, components of types that
+    // are not registered as serializable are skipped.
+    void instantiate(Node& into, World* world = nullptr) const;
+
+  private:
+    void* mapping = nullptr;
+    size_t length = 0;
+
+    const SceneFileHeader* header = nullptr;
+    const SceneFileNode* nodes = nullptr;
+    const SceneFileComponent* component_records = nullptr;
+    const std::byte* data = nullptr;
+    const char* strings = nullptr;
+};
+
+}; // namespace Engine
@@ -37,6 +37,44 @@ void main() {
 }
 )";
 
+// Instance attributes start at MESH_INSTANCE_LOCATION
+constexpr const char* INSTANCED_VERTEX_SHADER = R"(
+#version 330 core
+layout(location = 0) in vec3 v_pos;
+layout(location = 1) in vec2 v_tex_coord;
+layout(location = 8) in mat4 i_model;
+layout(location = 12) in vec4 i_color;
+layout(location = 13) in float i_texture_layer;
+
+uniform mat4 transform;
+out vec2 tex_coord;
+out vec4 tint;
+flat out float texture_layer;
+
+void main() {
+    gl_Position = transform * i_model * vec4(v_pos, 1.0);
+    tex_coord = v_tex_coord;
+    tint = i_color;
+    texture_layer = i_texture_layer;
+}
+)";
+
+// The texture layer is passed on for shaders sampling texture arrays, this one samples a plain texture
+constexpr const char* INSTANCED_FRAGMENT_SHADER = R"(
+#version 330 core
+out vec4 color;
+
+in vec2 tex_coord;
+in vec4 tint;
+flat in float texture_layer;
+
+uniform sampler2D texture0;
+
+void main() {
+    color = texture(texture0, tex_coord) * tint;
+}
+)";
+
 // Helper functions
 GLint getAttributeLocation(GLuint program, const std::string& name) {
     GLint location = glGetAttribLocation(program, name.data());
@@ -57,10 +95,10 @@ GLint getUniformLocation(GLuint program, const std::string& name) {
 }
 
 // Shader implementation
-Shader::Shader()
-    : vertex_shader_source{DEFAULT_VERTEX_SHADER}, fragment_shader_source{DEFAULT_FRAGMENT_SHADER}, is_built{false} {}
-
-Shader::~Shader() { glDeleteProgram(shader_program); }
+Shader::Shader(ShaderVariant variant)
+    : vertex_shader_source{variant == ShaderVariant::Instanced ? INSTANCED_VERTEX_SHADER : DEFAULT_VERTEX_SHADER},
+      fragment_shader_source{variant == ShaderVariant::Instanced ? INSTANCED_FRAGMENT_SHADER : DEFAULT_FRAGMENT_SHADER},
+      is_built{false} {}
 
 void Shader::setVertexShader(const std::string& vertex_shader_source) {
     this->vertex_shader_source = std::string(vertex_shader_source);
@@ -101,7 +139,7 @@ void Shader::build() {
     }
 
     // Linking shaders
-    shader_program = glCreateProgram();
+    shader_program = GpuProgram::create();
     glAttachShader(shader_program, vertex_shader);
     glAttachShader(shader_program, fragment_shader);
     glLinkProgram(shader_program);
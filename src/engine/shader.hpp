@@ -1,22 +1,35 @@
 #pragma once
 
+#include "engine/gpu_resource.hpp"
 #include <string>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
 namespace Engine {
 
+// Built-in shader sources. Instanced reads the model matrix, color and texture layer of Mesh::drawInstanced, and
+// expects transform to be projection * view only.
+enum class ShaderVariant {
+    Default,
+    Instanced,
+};
+
 class Shader {
 
   private:
     std::string vertex_shader_source;
     std::string fragment_shader_source;
-    GLuint shader_program;
+    GpuProgram shader_program;
     bool is_built = false;
 
   public:
-    Shader();
-    ~Shader();
+    explicit Shader(ShaderVariant variant = ShaderVariant::Default);
+
+    Shader(const Shader&) = delete;
+    Shader& operator=(const Shader&) = delete;
+    Shader(Shader&&) noexcept = default;
+    Shader& operator=(Shader&&) noexcept = default;
+
     void setVertexShader(const std::string& vertex_shader_source);
     void setFragmentShader(const std::string& fragment_shader_source);
 
@@ -1,88 +1,414 @@
 #include "engine/shapes.hpp"
-#include <random>
-#include <array>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numbers>
 #include <ranges>
+#include <span>
+#include <unordered_map>
 
 namespace Engine {
 
-Mesh cuboidMesh(float width, float height, float depth) {
-    if (height < 0) {
-        height = width;
+// Shape construction
+
+// Sizes a ShapeData up front and fills it in place
+struct ShapeWriter {
+    ShapeData& shape;
+    uint vertex = 0;
+    size_t index = 0;
+
+    ShapeWriter(ShapeData& shape, size_t vertex_count, size_t index_count) : shape{shape} {
+        shape.positions.resize(vertex_count);
+        shape.normals.resize(vertex_count);
+        shape.uvs.resize(vertex_count);
+        shape.indices.resize(index_count);
     }
-    if (depth < 0) {
-        depth = width;
+
+    uint addVertex(glm::vec3 position, glm::vec3 normal, glm::vec2 uv) {
+        assert(vertex < shape.positions.size() && "Shape has more vertices than it was sized for");
+        shape.positions[vertex] = position;
+        shape.normals[vertex] = normal;
+        shape.uvs[vertex] = uv;
+        return vertex++;
     }
 
-    Mesh mesh;
+    void addTriangle(uint a, uint b, uint c) {
+        assert(index + 3 <= shape.indices.size() && "Shape has more indices than it was sized for");
+        shape.indices[index++] = a;
+        shape.indices[index++] = b;
+        shape.indices[index++] = c;
+    }
 
-    mesh.setVertexPositions<glm::vec3>({
-        {-width, -height, -depth},
-        {-width, -height, depth},
-        {-width, height, -depth},
-        {-width, height, depth},
-        {width, -height, -depth},
-        {width, -height, depth},
-        {width, height, -depth},
-        {width, height, depth},
-    });
-
-    mesh.setAssociatedData<glm::vec2>(1, {
-                                             {0.f, 0.f},
-                                             {0.f, 1.f},
-                                             {1.f, 0.f},
-                                             {1.f, 1.f},
-                                             {1.f, 0.f},
-                                             {1.f, 0.f},
-                                             {1.f, 1.f},
-                                             {1.f, 0.f},
-                                         });
-
-    mesh.setElementBuffer({
-        0b000, 0b001, 0b011, 0b000, 0b001, 0b101, 0b000, 0b010, 0b011, 0b000, 0b010, 0b110,
-        0b000, 0b100, 0b101, 0b000, 0b100, 0b110, 0b001, 0b011, 0b111, 0b001, 0b101, 0b111,
-        0b010, 0b011, 0b111, 0b010, 0b110, 0b111, 0b100, 0b101, 0b111, 0b100, 0b110, 0b111,
-
-    });
+    // Two triangles per cell of a grid of vertices stored row by row from first. The front faces are on the side the
+    // cross product of the row direction and the column direction points to.
+    void addGrid(uint first, size_t rows, size_t columns) {
+        auto row_size = static_cast<uint>(columns + 1);
+        for (uint row = 0; row < rows; row++) {
+            for (uint column = 0; column < columns; column++) {
+                auto a = first + row * row_size + column;
+                auto b = a + row_size;
+                addTriangle(a, b, a + 1);
+                addTriangle(a + 1, b, b + 1);
+            }
+        }
+    }
 
-    return mesh;
+    void finish() const {
+        assert(vertex == shape.positions.size() && index == shape.indices.size() &&
+               "Shape has fewer vertices or indices than it was sized for");
+    }
+};
+
+// Cosine and sine of steps + 1 evenly spaced angles from begin to end. Values that are zero up to float precision are
+// made exactly zero, and a full turn ends on an exact copy of its first entry, so that poles and seams line up.
+static std::vector<glm::vec2> makeTrigTable(size_t steps, double begin, double end) {
+    std::vector<glm::vec2> table(steps + 1);
+    for (size_t i = 0; i <= steps; i++) {
+        auto angle = begin + (end - begin) * static_cast<double>(i) / static_cast<double>(steps);
+        auto snap = [](double x) { return std::abs(x) < 1e-7 ? 0.f : static_cast<float>(x); };
+        table[i] = {snap(std::cos(angle)), snap(std::sin(angle))};
+    }
+    if (std::abs(std::abs(end - begin) - 2 * std::numbers::pi) < 1e-9) {
+        table[steps] = table[0];
+    }
+    return table;
 }
 
-Mesh sphereMesh(float radius, size_t splits) {
-    Mesh mesh;
+// A point of a profile that is revolved around the y axis. The normal is given in the (radius, y) plane.
+struct ProfilePoint {
+    float radius;
+    float y;
+    glm::vec2 normal;
+    float v;
+};
+
+static size_t latheTriangleCount(std::span<const ProfilePoint> profile, size_t slices) {
+    size_t count = 0;
+    for (size_t k = 0; k + 1 < profile.size(); k++) {
+        count += (profile[k].radius != 0.f) + (profile[k + 1].radius != 0.f);
+    }
+    return count * slices;
+}
+
+// Revolves a profile that runs downwards along the outside of the surface, giving one row of vertices per point.
+// Points on the axis still get a full row, each vertex with its own u, but the triangles that would be degenerate
+// there are left out.
+static void lathe(ShapeWriter& writer, std::span<const ProfilePoint> profile, std::span<const glm::vec2> slice_table) {
+    auto slices = slice_table.size() - 1;
+    auto first = writer.vertex;
+    for (auto& point : profile) {
+        for (size_t j = 0; j <= slices; j++) {
+            auto direction = slice_table[j];
+            writer.addVertex({point.radius * direction.x, point.y, -point.radius * direction.y},
+                             {point.normal.x * direction.x, point.normal.y, -point.normal.x * direction.y},
+                             {static_cast<float>(j) / slices, point.v});
+        }
+    }
+
+    auto row_size = static_cast<uint>(slices + 1);
+    for (uint k = 0; k + 1 < profile.size(); k++) {
+        for (uint j = 0; j < slices; j++) {
+            auto a = first + k * row_size + j;
+            auto b = a + row_size;
+            if (profile[k].radius != 0.f) {
+                writer.addTriangle(a, b, a + 1);
+            }
+            if (profile[k + 1].radius != 0.f) {
+                writer.addTriangle(a + 1, b, b + 1);
+            }
+        }
+    }
+}
+
+ShapeData generateCuboid(glm::vec3 half_extents) {
+    // Normal, then the directions right and down when looking at the face from outside
+    constexpr glm::vec3 faces[6][3] = {
+        {{1, 0, 0}, {0, 0, -1}, {0, -1, 0}}, {{-1, 0, 0}, {0, 0, 1}, {0, -1, 0}},
+        {{0, 1, 0}, {1, 0, 0}, {0, 0, 1}},   {{0, -1, 0}, {1, 0, 0}, {0, 0, -1}},
+        {{0, 0, 1}, {1, 0, 0}, {0, -1, 0}},  {{0, 0, -1}, {-1, 0, 0}, {0, -1, 0}},
+    };
 
-    std::vector<glm::vec3> vertices;
-    std::vector<std::array<size_t, 3>> indices;
-
-    for (size_t i = 0; i <= splits; ++i) {
-        float theta = i * std::numbers::pi / splits;
-        for (size_t j = 0; j <= splits; ++j) {
-            float phi = j * 2.f * std::numbers::pi / splits;
-            float x = radius * sin(theta) * cos(phi);
-            float y = radius * sin(theta) * sin(phi);
-            float z = radius * cos(theta);
-            vertices.push_back({x, y, z});
+    ShapeData shape;
+    ShapeWriter writer{shape, 6 * 4, 6 * 6};
+    for (auto& [normal, right, down] : faces) {
+        auto first = writer.vertex;
+        for (int t = 0; t < 2; t++) {
+            for (int s = 0; s < 2; s++) {
+                auto position = normal + right * (2.f * s - 1.f) + down * (2.f * t - 1.f);
+                writer.addVertex(position * half_extents, normal, {s, t});
+            }
         }
+        writer.addGrid(first, 1, 1);
     }
+    writer.finish();
+    return shape;
+}
 
-    for (size_t i = 0; i < splits; ++i) {
-        for (size_t j = 0; j < splits; ++j) {
-            size_t a = i * (splits + 1) + j;
-            size_t b = a + splits + 1;
-            size_t c = a + 1;
-            size_t d = b + 1;
+ShapeData generateSphere(float radius, size_t slices, size_t stacks) {
+    assert(slices >= 3 && stacks >= 2);
+    auto stack_table = makeTrigTable(stacks, 0.0, std::numbers::pi);
+    std::vector<ProfilePoint> profile(stacks + 1);
+    for (size_t k = 0; k <= stacks; k++) {
+        auto y = stack_table[k].x, r = stack_table[k].y;
+        profile[k] = {radius * r, radius * y, {r, y}, static_cast<float>(k) / stacks};
+    }
 
-            indices.push_back({a, b, c});
-            indices.push_back({b, d, c});
+    ShapeData shape;
+    ShapeWriter writer{shape, (stacks + 1) * (slices + 1), latheTriangleCount(profile, slices) * 3};
+    lathe(writer, profile, makeTrigTable(slices, 0.0, 2 * std::numbers::pi));
+    writer.finish();
+    return shape;
+}
+
+ShapeData generateIcosphere(float radius, size_t subdivisions) {
+    constexpr float t = std::numbers::phi_v<float>;
+    std::vector<glm::vec3> directions = {
+        {-1, t, 0}, {1, t, 0}, {-1, -t, 0}, {1, -t, 0}, {0, -1, t}, {0, 1, t},
+        {0, -1, -t}, {0, 1, -t}, {t, 0, -1}, {t, 0, 1}, {-t, 0, -1}, {-t, 0, 1},
+    };
+    std::vector<uint> indices = {
+        0, 11, 5, 0, 5, 1, 0, 1, 7, 0, 7, 10, 0, 10, 11, 1, 5, 9, 5, 11, 4, 11, 10, 2, 10, 7, 6, 7, 1, 8,
+        3, 9, 4, 3, 4, 2, 3, 2, 6, 3, 6, 8, 3, 8, 9, 4, 9, 5, 2, 4, 11, 6, 2, 10, 8, 6, 7, 9, 8, 1,
+    };
+
+    // Every subdivision splits each triangle into four, sharing the new vertex of each edge between its two triangles
+    size_t final_vertices = 10 * (size_t{1} << (2 * subdivisions)) + 2;
+    directions.reserve(final_vertices);
+    std::unordered_map<uint64_t, uint> midpoints;
+    midpoints.reserve(final_vertices);
+    for (size_t level = 0; level < subdivisions; level++) {
+        midpoints.clear();
+        auto midpoint = [&](uint a, uint b) {
+            auto key = (uint64_t{std::min(a, b)} << 32) | std::max(a, b);
+            auto [it, inserted] = midpoints.try_emplace(key, static_cast<uint>(directions.size()));
+            if (inserted) {
+                directions.push_back(directions[a] + directions[b]);
+            }
+            return it->second;
+        };
+
+        std::vector<uint> subdivided(indices.size() * 4);
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            auto a = indices[i], b = indices[i + 1], c = indices[i + 2];
+            auto ab = midpoint(a, b), bc = midpoint(b, c), ca = midpoint(c, a);
+            uint triangles[12] = {a, ab, ca, b, bc, ab, c, ca, bc, ab, bc, ca};
+            std::copy_n(triangles, 12, subdivided.begin() + i * 4);
         }
+        indices = std::move(subdivided);
     }
 
-    mesh.setVertexPositions<glm::vec3>(vertices.data(), vertices.size());
-    auto indices_flat = indices | std::views::join | std::ranges::to<std::vector<GLuint>>();
-    mesh.setElementBuffer(indices_flat.data(), indices_flat.size());
+    ShapeData shape;
+    shape.positions.reserve(final_vertices);
+    shape.normals.reserve(final_vertices);
+    shape.uvs.reserve(final_vertices);
+    for (auto& direction : directions) {
+        auto normal = glm::normalize(direction);
+        auto u = std::atan2(-normal.z, normal.x) / (2 * std::numbers::pi_v<float>);
+        auto v = std::acos(std::clamp(normal.y, -1.f, 1.f)) / std::numbers::pi_v<float>;
+        shape.positions.push_back(normal * radius);
+        shape.normals.push_back(normal);
+        shape.uvs.push_back({u < 0.f ? u + 1.f : u, v});
+    }
+
+    // Triangles crossing the u = 0 seam get copies of their vertices on the u < 0.5 side with u moved up by one
+    std::unordered_map<uint, uint> seam_copies;
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        auto corners = std::span{indices}.subspan(i, 3);
+        auto [low, high] = std::ranges::minmax(corners | std::views::transform([&](uint v) { return shape.uvs[v].x; }));
+        if (high - low <= 0.5f) {
+            continue;
+        }
+        for (auto& corner : corners) {
+            if (shape.uvs[corner].x < 0.5f) {
+                auto [it, inserted] = seam_copies.try_emplace(corner, static_cast<uint>(shape.positions.size()));
+                if (inserted) {
+                    shape.positions.push_back(shape.positions[corner]);
+                    shape.normals.push_back(shape.normals[corner]);
+                    shape.uvs.push_back(shape.uvs[corner] + glm::vec2{1.f, 0.f});
+                }
+                corner = it->second;
+            }
+        }
+    }
+
+    shape.indices = std::move(indices);
+    return shape;
+}
+
+ShapeData generateCylinder(float radius, float height, size_t slices, size_t stacks) {
+    assert(slices >= 3 && stacks >= 1);
+    std::vector<ProfilePoint> profile(stacks + 1);
+    for (size_t k = 0; k <= stacks; k++) {
+        auto v = static_cast<float>(k) / stacks;
+        profile[k] = {radius, height * (0.5f - v), {1.f, 0.f}, v};
+    }
+
+    ShapeData shape;
+    auto slice_table = makeTrigTable(slices, 0.0, 2 * std::numbers::pi);
+    ShapeWriter writer{shape, (stacks + 1) * (slices + 1) + 2 * (slices + 1), (stacks * 2 + 2) * slices * 3};
+    lathe(writer, profile, slice_table);
+
+    // Caps are fans around their center, with the disc mapped onto the whole texture
+    for (float side : {1.f, -1.f}) {
+        glm::vec3 normal{0.f, side, 0.f};
+        auto center = writer.addVertex(normal * height * 0.5f, normal, {0.5f, 0.5f});
+        for (size_t j = 0; j < slices; j++) {
+            auto direction = slice_table[j];
+            writer.addVertex({radius * direction.x, side * height * 0.5f, -radius * direction.y}, normal,
+                             {0.5f + 0.5f * direction.x, 0.5f - 0.5f * side * direction.y});
+        }
+        for (uint j = 0; j < slices; j++) {
+            auto a = center + 1 + j;
+            auto b = center + 1 + (j + 1) % static_cast<uint>(slices);
+            if (side > 0.f) {
+                writer.addTriangle(center, a, b);
+            } else {
+                writer.addTriangle(center, b, a);
+            }
+        }
+    }
+    writer.finish();
+    return shape;
+}
 
+ShapeData generateCapsule(float radius, float height, size_t slices, size_t rings) {
+    assert(slices >= 3 && rings >= 1);
+    // One table for both caps, the equator entry is used by each of them
+    auto ring_table = makeTrigTable(2 * rings, 0.0, std::numbers::pi);
+    auto length = std::numbers::pi_v<float> * radius + height;
+
+    std::vector<ProfilePoint> profile(2 * rings + 2);
+    for (size_t k = 0; k < profile.size(); k++) {
+        auto bottom = k > rings;
+        auto step = bottom ? k - 1 : k;
+        auto y = ring_table[step].x, r = ring_table[step].y;
+        auto arc = std::numbers::pi_v<float> * radius * step / (2 * rings) + (bottom ? height : 0.f);
+        profile[k] = {radius * r, radius * y + (bottom ? -0.5f : 0.5f) * height, {r, y}, arc / length};
+    }
+
+    ShapeData shape;
+    ShapeWriter writer{shape, profile.size() * (slices + 1), latheTriangleCount(profile, slices) * 3};
+    lathe(writer, profile, makeTrigTable(slices, 0.0, 2 * std::numbers::pi));
+    writer.finish();
+    return shape;
+}
+
+ShapeData generateTorus(float major_radius, float minor_radius, size_t major_segments, size_t minor_segments) {
+    assert(major_segments >= 3 && minor_segments >= 3);
+    assert(major_radius > minor_radius && "The tube would cross the axis");
+    // Going down the outside of the tube means starting at its top and turning outwards
+    auto tube_table = makeTrigTable(minor_segments, std::numbers::pi / 2, std::numbers::pi / 2 - 2 * std::numbers::pi);
+    std::vector<ProfilePoint> profile(minor_segments + 1);
+    for (size_t k = 0; k <= minor_segments; k++) {
+        auto direction = tube_table[k];
+        profile[k] = {major_radius + minor_radius * direction.x, minor_radius * direction.y, direction,
+                      static_cast<float>(k) / minor_segments};
+    }
+
+    ShapeData shape;
+    ShapeWriter writer{shape, (minor_segments + 1) * (major_segments + 1), minor_segments * major_segments * 6};
+    lathe(writer, profile, makeTrigTable(major_segments, 0.0, 2 * std::numbers::pi));
+    writer.finish();
+    return shape;
+}
+
+ShapeData generatePlane(glm::vec2 size, size_t x_segments, size_t z_segments) {
+    assert(x_segments >= 1 && z_segments >= 1);
+    ShapeData shape;
+    ShapeWriter writer{shape, (x_segments + 1) * (z_segments + 1), x_segments * z_segments * 6};
+    for (size_t row = 0; row <= z_segments; row++) {
+        auto v = static_cast<float>(row) / z_segments;
+        for (size_t column = 0; column <= x_segments; column++) {
+            auto u = static_cast<float>(column) / x_segments;
+            writer.addVertex({size.x * (u - 0.5f), 0.f, size.y * (v - 0.5f)}, {0.f, 1.f, 0.f}, {u, v});
+        }
+    }
+    writer.addGrid(0, z_segments, x_segments);
+    writer.finish();
+    return shape;
+}
+
+Mesh makeMesh(ShapeData&& shape) {
+    Mesh mesh;
+    mesh.setVertexPositions(std::move(shape.positions));
+    mesh.setAssociatedData(SHAPE_UV_FIELD, std::move(shape.uvs));
+    mesh.setAssociatedData(SHAPE_NORMAL_FIELD, std::move(shape.normals));
+    mesh.setElementBuffer(std::move(shape.indices));
     return mesh;
 }
 
+Mesh cuboidMesh(float width, float height, float depth) {
+    if (height < 0) {
+        height = width;
+    }
+    if (depth < 0) {
+        depth = width;
+    }
+    return makeMesh(generateCuboid({width, height, depth}));
+}
+
+Mesh sphereMesh(float radius, size_t splits) { return makeMesh(generateSphere(radius, splits, splits)); }
+
+Mesh icosphereMesh(float radius, size_t subdivisions) { return makeMesh(generateIcosphere(radius, subdivisions)); }
+
+Mesh cylinderMesh(float radius, float height, size_t slices) {
+    return makeMesh(generateCylinder(radius, height, slices));
+}
+
+Mesh capsuleMesh(float radius, float height, size_t slices, size_t rings) {
+    return makeMesh(generateCapsule(radius, height, slices, rings));
+}
+
+Mesh torusMesh(float major_radius, float minor_radius, size_t major_segments, size_t minor_segments) {
+    return makeMesh(generateTorus(major_radius, minor_radius, major_segments, minor_segments));
+}
+
+Mesh planeMesh(float width, float depth, size_t x_segments, size_t z_segments) {
+    return makeMesh(generatePlane({width, depth}, x_segments, z_segments));
+}
+
+// Shape cache
+std::shared_ptr<Mesh> ShapeCache::cuboid(glm::vec3 half_extents) {
+    return find({Shape::Cuboid, {half_extents.x, half_extents.y, half_extents.z}},
+                [&]() { return generateCuboid(half_extents); });
+}
+
+std::shared_ptr<Mesh> ShapeCache::sphere(float radius, size_t slices, size_t stacks) {
+    return find({Shape::Sphere, {radius, float(slices), float(stacks)}},
+                [&]() { return generateSphere(radius, slices, stacks); });
+}
+
+std::shared_ptr<Mesh> ShapeCache::icosphere(float radius, size_t subdivisions) {
+    return find({Shape::Icosphere, {radius, float(subdivisions)}},
+                [&]() { return generateIcosphere(radius, subdivisions); });
+}
+
+std::shared_ptr<Mesh> ShapeCache::cylinder(float radius, float height, size_t slices, size_t stacks) {
+    return find({Shape::Cylinder, {radius, height, float(slices), float(stacks)}},
+                [&]() { return generateCylinder(radius, height, slices, stacks); });
+}
+
+std::shared_ptr<Mesh> ShapeCache::capsule(float radius, float height, size_t slices, size_t rings) {
+    return find({Shape::Capsule, {radius, height, float(slices), float(rings)}},
+                [&]() { return generateCapsule(radius, height, slices, rings); });
+}
+
+std::shared_ptr<Mesh> ShapeCache::torus(float major_radius, float minor_radius, size_t major_segments,
+                                        size_t minor_segments) {
+    return find({Shape::Torus, {major_radius, minor_radius, float(major_segments), float(minor_segments)}},
+                [&]() { return generateTorus(major_radius, minor_radius, major_segments, minor_segments); });
+}
+
+std::shared_ptr<Mesh> ShapeCache::plane(glm::vec2 size, size_t x_segments, size_t z_segments) {
+    return find({Shape::Plane, {size.x, size.y, float(x_segments), float(z_segments)}},
+                [&]() { return generatePlane(size, x_segments, z_segments); });
+}
+
+ShapeCache::Stats ShapeCache::getStats() const {
+    auto live = std::ranges::count_if(meshes, [](auto& entry) { return !entry.second.expired(); });
+    return {hits, misses, static_cast<size_t>(live)};
+}
+
 // Mesh randomShape(size_t splits) {
 //     static std::random_device rd;
 //     static std::minstd_rand rng(rd());
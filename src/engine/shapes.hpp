@@ -1,11 +1,94 @@
 #pragma once
 #include "engine/mesh.hpp"
+#include <array>
+#include <compare>
+#include <map>
+#include <memory>
 
 namespace Engine {
 
+// Fields of the meshes built from shapes; the positions are field 0
+constexpr size_t SHAPE_UV_FIELD = 1;
+constexpr size_t SHAPE_NORMAL_FIELD = 2;
+
+// Vertices and counter-clockwise triangles of a generated shape, the y axis pointing up. Generators size every array
+// up front and fill it in place. Curved surfaces repeat the vertices of their UV seams, so welding them merges nothing.
+struct ShapeData {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> uvs;
+    std::vector<uint> indices;
+};
+
+// Boxes are given by their half extents, every face with its own four vertices
+ShapeData generateCuboid(glm::vec3 half_extents);
+ShapeData generateSphere(float radius, size_t slices, size_t stacks);
+ShapeData generateIcosphere(float radius, size_t subdivisions);
+ShapeData generateCylinder(float radius, float height, size_t slices, size_t stacks = 1);
+// Height is the length of the straight part, the caps add radius at either end
+ShapeData generateCapsule(float radius, float height, size_t slices, size_t rings);
+ShapeData generateTorus(float major_radius, float minor_radius, size_t major_segments, size_t minor_segments);
+// A grid in the xz plane, facing up
+ShapeData generatePlane(glm::vec2 size, size_t x_segments = 1, size_t z_segments = 1);
+
+// Moves the shape's arrays into a new mesh
+Mesh makeMesh(ShapeData&& shape);
+
 Mesh cuboidMesh(float width, float height = -1, float depth = -1);
 Mesh sphereMesh(float radius, size_t splits = 10);
+Mesh icosphereMesh(float radius, size_t subdivisions = 3);
+Mesh cylinderMesh(float radius, float height, size_t slices = 32);
+Mesh capsuleMesh(float radius, float height, size_t slices = 32, size_t rings = 8);
+Mesh torusMesh(float major_radius, float minor_radius, size_t major_segments = 48, size_t minor_segments = 24);
+Mesh planeMesh(float width, float depth, size_t x_segments = 1, size_t z_segments = 1);
+
+// Meshes of generated shapes by shape and parameters. Asking again for a shape that is still alive returns the same
+// mesh, so all of its users share one set of GPU buffers; they must not change its data. A mesh is generated anew once
+// every previous user has let go of it.
+class ShapeCache {
+  public:
+    std::shared_ptr<Mesh> cuboid(glm::vec3 half_extents);
+    std::shared_ptr<Mesh> sphere(float radius, size_t slices, size_t stacks);
+    std::shared_ptr<Mesh> icosphere(float radius, size_t subdivisions);
+    std::shared_ptr<Mesh> cylinder(float radius, float height, size_t slices, size_t stacks = 1);
+    std::shared_ptr<Mesh> capsule(float radius, float height, size_t slices, size_t rings);
+    std::shared_ptr<Mesh> torus(float major_radius, float minor_radius, size_t major_segments, size_t minor_segments);
+    std::shared_ptr<Mesh> plane(glm::vec2 size, size_t x_segments = 1, size_t z_segments = 1);
+
+    struct Stats {
+        size_t hits;
+        size_t misses;
+        size_t live; // shapes currently held by someone
+    };
+    Stats getStats() const;
+
+  private:
+    enum class Shape { Cuboid, Sphere, Icosphere, Cylinder, Capsule, Torus, Plane };
+
+    struct Key {
+        Shape shape;
+        std::array<float, 4> parameters;
+
+        auto operator<=>(const Key&) const = default;
+    };
+
+    std::map<Key, std::weak_ptr<Mesh>> meshes;
+    size_t hits = 0;
+    size_t misses = 0;
+
+    template <typename Generate> std::shared_ptr<Mesh> find(const Key& key, Generate generate) {
+        auto& entry = meshes[key];
+        if (auto mesh = entry.lock()) {
+            hits++;
+            return mesh;
+        }
 
-// Mesh randomShape(size_t splits = 10);
+        misses++;
+        std::erase_if(meshes, [&](auto& other) { return other.first != key && other.second.expired(); });
+        auto mesh = std::make_shared<Mesh>(makeMesh(generate()));
+        entry = mesh;
+        return mesh;
+    }
+};
 
 } // namespace Engine
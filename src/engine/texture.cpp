@@ -6,15 +6,9 @@
 
 namespace Engine {
 
-Texture::Texture() : loaded(false) {}
+Texture::Texture() {}
 
-Texture::Texture(const std::string& path) : loaded(false) { load(path); }
-
-Texture::~Texture() {
-    if (loaded) {
-        glDeleteTextures(1, &texture);
-    }
-}
+Texture::Texture(const std::string& path) { load(path); }
 
 void Texture::load(const std::string& path) {
     int width, height, channels;
@@ -27,7 +21,8 @@ void Texture::load(const std::string& path) {
     GLenum format = channels == 3 ? GL_RGB : GL_RGBA;
     DBG("Loaded texture: " << path << " (" << width << "x" << height << ", " << channels << " channels)");
 
-    glGenTextures(1, &texture);
+    // Reloading drops the previous image once the GPU is done with it
+    texture = GpuTexture::create();
     glBindTexture(GL_TEXTURE_2D, texture);
 
     auto wrap_ = static_cast<GLenum>(wrap);
@@ -42,8 +37,6 @@ void Texture::load(const std::string& path) {
     glGenerateMipmap(GL_TEXTURE_2D);
 
     stbi_image_free(data);
-
-    loaded = true;
 }
 
 void Texture::bind(GLuint index) {
@@ -53,7 +46,7 @@ void Texture::bind(GLuint index) {
 
 void Texture::setWrap(TextureWrap wrap) {
     this->wrap = wrap;
-    if (loaded) {
+    if (texture) {
         glBindTexture(GL_TEXTURE_2D, texture);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, static_cast<GLenum>(wrap));
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, static_cast<GLenum>(wrap));
@@ -1,4 +1,5 @@
 #pragma once
+#include "engine/gpu_resource.hpp"
 #include <glad/glad.h>
 #include <string>
 
@@ -12,14 +13,17 @@ enum class TextureWrap {
 
 class Texture {
   private:
-    GLuint texture;
-    bool loaded = false;
+    GpuTexture texture; // empty until loaded
     TextureWrap wrap = TextureWrap::ClampToEdge;
 
   public:
     explicit Texture();
     explicit Texture(const std::string& path);
-    ~Texture();
+
+    Texture(const Texture&) = delete;
+    Texture& operator=(const Texture&) = delete;
+    Texture(Texture&&) noexcept = default;
+    Texture& operator=(Texture&&) noexcept = default;
 
     void load(const std::string& path);
     void setWrap(TextureWrap wrap);
@@ -0,0 +1,318 @@
+#pragma once
+
+#include "engine/vertex_layout.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+#include <limits>
+#include <type_traits>
+
+namespace Engine {
+
+// GPU side encoding of a float attribute. Everything but Float is decoded to floats by the vertex fetch, so shaders
+// keep declaring vecN inputs (except Octahedral, see OCTAHEDRAL_DECODE_GLSL).
+enum class VertexFormat : uint8_t {
+    Float,           // 4 bytes per component
+    Half,            // 2 bytes per component
+    Snorm8,          // [-1, 1], 1 byte per component
+    Unorm8,          // [0, 1], 1 byte per component
+    Snorm16,         // [-1, 1], 2 bytes per component
+    Unorm16,         // [0, 1], 2 bytes per component
+    Snorm10_10_10_2, // vec3 or vec4 in [-1, 1] packed into 4 bytes, w keeps only its sign
+    Octahedral,      // unit vec3 folded onto an octahedron and stored as 2 x snorm16
+};
+
+// Decodes an Octahedral attribute, which arrives in the shader as a vec2
+constexpr const char* OCTAHEDRAL_DECODE_GLSL = R"(
+vec3 decodeOctahedral(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+)";
+
+// Bytes one attribute takes in a vertex, padded to 4 so every attribute stays 4 byte aligned
+constexpr size_t vertexFormatSize(VertexFormat format, size_t components) {
+    size_t size = 0;
+    switch (format) {
+    case VertexFormat::Float:
+        size = 4 * components;
+        break;
+    case VertexFormat::Half:
+    case VertexFormat::Snorm16:
+    case VertexFormat::Unorm16:
+        size = 2 * components;
+        break;
+    case VertexFormat::Snorm8:
+    case VertexFormat::Unorm8:
+        size = components;
+        break;
+    case VertexFormat::Snorm10_10_10_2:
+    case VertexFormat::Octahedral:
+        size = 4;
+        break;
+    }
+    return (size + 3) / 4 * 4;
+}
+
+constexpr VertexAttributeFormat vertexAttributeFormat(VertexFormat format, size_t components, size_t offset) {
+    auto n = static_cast<GLint>(components);
+    switch (format) {
+    case VertexFormat::Float:
+        return {n, GL_FLOAT, GL_FALSE, offset};
+    case VertexFormat::Half:
+        return {n, GL_HALF_FLOAT, GL_FALSE, offset};
+    case VertexFormat::Snorm8:
+        return {n, GL_BYTE, GL_TRUE, offset};
+    case VertexFormat::Unorm8:
+        return {n, GL_UNSIGNED_BYTE, GL_TRUE, offset};
+    case VertexFormat::Snorm16:
+        return {n, GL_SHORT, GL_TRUE, offset};
+    case VertexFormat::Unorm16:
+        return {n, GL_UNSIGNED_SHORT, GL_TRUE, offset};
+    case VertexFormat::Snorm10_10_10_2:
+        return {4, GL_INT_2_10_10_10_REV, GL_TRUE, offset};
+    case VertexFormat::Octahedral:
+        return {2, GL_SHORT, GL_TRUE, offset};
+    }
+    return {n, GL_FLOAT, GL_FALSE, offset};
+}
+
+// Whether values of type T can be stored in format
+template <typename T> constexpr bool isVertexFormatSupported(VertexFormat format) {
+    switch (format) {
+    case VertexFormat::Snorm10_10_10_2:
+        return T::length() >= 3;
+    case VertexFormat::Octahedral:
+        return T::length() == 3;
+    default:
+        return true;
+    }
+}
+
+template <typename Int> Int packNormalized(float value, bool is_signed) {
+    constexpr float max = static_cast<float>(std::numeric_limits<Int>::max());
+    value = is_signed ? std::clamp(value, -1.f, 1.f) : std::clamp(value, 0.f, 1.f);
+    return static_cast<Int>(std::round(value * max));
+}
+
+inline uint32_t packSnorm10_10_10_2(const glm::vec4& v) {
+    auto field = [](float value, float max, uint32_t bits) {
+        auto packed = static_cast<int32_t>(std::round(std::clamp(value, -1.f, 1.f) * max));
+        return static_cast<uint32_t>(packed) & ((1u << bits) - 1);
+    };
+    return field(v.x, 511.f, 10) | field(v.y, 511.f, 10) << 10 | field(v.z, 511.f, 10) << 20 |
+           field(v.w, 1.f, 2) << 30;
+}
+
+// Maps a unit vector onto the [-1, 1] square by folding the lower half of the octahedron over the upper one
+inline glm::vec2 encodeOctahedral(glm::vec3 n) {
+    n /= std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    glm::vec2 e{n.x, n.y};
+    if (n.z < 0) {
+        e = (1.f - glm::abs(glm::vec2{e.y, e.x})) * glm::vec2{e.x >= 0 ? 1.f : -1.f, e.y >= 0 ? 1.f : -1.f};
+    }
+    return e;
+}
+
+// Inverse of encodeOctahedral, as OCTAHEDRAL_DECODE_GLSL does it on the GPU
+inline glm::vec3 decodeOctahedral(glm::vec2 e) {
+    glm::vec3 n{e.x, e.y, 1.f - std::abs(e.x) - std::abs(e.y)};
+    auto t = std::max(-n.z, 0.f);
+    n.x += n.x >= 0.f ? -t : t;
+    n.y += n.y >= 0.f ? -t : t;
+    return glm::normalize(n);
+}
+
+template <typename Int> float unpackNormalized(Int value) {
+    constexpr float max = static_cast<float>(std::numeric_limits<Int>::max());
+    return std::max(value / max, -1.f);
+}
+
+inline glm::vec4 unpackSnorm10_10_10_2(uint32_t packed) {
+    // Shifting the field to the top and back sign-extends it
+    auto field = [&](uint32_t shift, uint32_t bits, float max) {
+        auto value = static_cast<int32_t>(packed << (32 - shift - bits)) >> (32 - bits);
+        return std::max(value / max, -1.f);
+    };
+    return {field(0, 10, 511.f), field(10, 10, 511.f), field(20, 10, 511.f), field(30, 2, 1.f)};
+}
+
+// Encodes one value of type T (glm::vecN) into out, which has room for vertexFormatSize(F, N) bytes
+template <VertexFormat F, typename T> void encodeVertexValue(const T& value, std::byte* out) {
+    constexpr auto N = T::length();
+
+    if constexpr (F == VertexFormat::Float) {
+        std::memcpy(out, &value, sizeof(T));
+    } else if constexpr (F == VertexFormat::Half) {
+        uint16_t packed[N];
+        for (glm::length_t i = 0; i < N; i++) {
+            packed[i] = glm::packHalf1x16(value[i]);
+        }
+        std::memcpy(out, packed, sizeof(packed));
+    } else if constexpr (F == VertexFormat::Snorm8 || F == VertexFormat::Unorm8) {
+        using Int = std::conditional_t<F == VertexFormat::Snorm8, int8_t, uint8_t>;
+        Int packed[N];
+        for (glm::length_t i = 0; i < N; i++) {
+            packed[i] = packNormalized<Int>(value[i], F == VertexFormat::Snorm8);
+        }
+        std::memcpy(out, packed, sizeof(packed));
+    } else if constexpr (F == VertexFormat::Snorm16 || F == VertexFormat::Unorm16) {
+        using Int = std::conditional_t<F == VertexFormat::Snorm16, int16_t, uint16_t>;
+        Int packed[N];
+        for (glm::length_t i = 0; i < N; i++) {
+            packed[i] = packNormalized<Int>(value[i], F == VertexFormat::Snorm16);
+        }
+        std::memcpy(out, packed, sizeof(packed));
+    } else if constexpr (F == VertexFormat::Snorm10_10_10_2) {
+        static_assert(N >= 3);
+        glm::vec4 v{value[0], value[1], value[2], 1.f};
+        if constexpr (N == 4) {
+            v.w = value[3];
+        }
+        auto packed = packSnorm10_10_10_2(v);
+        std::memcpy(out, &packed, sizeof(packed));
+    } else if constexpr (F == VertexFormat::Octahedral) {
+        static_assert(N == 3);
+        auto e = encodeOctahedral(value);
+        int16_t packed[2] = {packNormalized<int16_t>(e.x, true), packNormalized<int16_t>(e.y, true)};
+        std::memcpy(out, packed, sizeof(packed));
+    }
+}
+
+// Decodes one value of type T stored in format F, the way the vertex fetch would
+template <VertexFormat F, typename T> T decodeVertexValue(const std::byte* in) {
+    constexpr auto N = T::length();
+    T value{};
+
+    if constexpr (F == VertexFormat::Float) {
+        std::memcpy(&value, in, sizeof(T));
+    } else if constexpr (F == VertexFormat::Half) {
+        uint16_t packed[N];
+        std::memcpy(packed, in, sizeof(packed));
+        for (glm::length_t i = 0; i < N; i++) {
+            value[i] = glm::unpackHalf1x16(packed[i]);
+        }
+    } else if constexpr (F == VertexFormat::Snorm8 || F == VertexFormat::Unorm8 || F == VertexFormat::Snorm16 ||
+                         F == VertexFormat::Unorm16) {
+        using Int = std::conditional_t<
+            F == VertexFormat::Snorm8, int8_t,
+            std::conditional_t<F == VertexFormat::Unorm8, uint8_t,
+                               std::conditional_t<F == VertexFormat::Snorm16, int16_t, uint16_t>>>;
+        Int packed[N];
+        std::memcpy(packed, in, sizeof(packed));
+        for (glm::length_t i = 0; i < N; i++) {
+            value[i] = unpackNormalized(packed[i]);
+        }
+    } else if constexpr (F == VertexFormat::Snorm10_10_10_2) {
+        static_assert(N >= 3);
+        uint32_t packed;
+        std::memcpy(&packed, in, sizeof(packed));
+        auto v = unpackSnorm10_10_10_2(packed);
+        for (glm::length_t i = 0; i < N; i++) {
+            value[i] = v[i];
+        }
+    } else if constexpr (F == VertexFormat::Octahedral) {
+        static_assert(N == 3);
+        int16_t packed[2];
+        std::memcpy(packed, in, sizeof(packed));
+        value = decodeOctahedral({unpackNormalized(packed[0]), unpackNormalized(packed[1])});
+    }
+    return value;
+}
+
+// Like interleaveAttribute, encoding every value into format on the way
+template <typename T>
+void interleaveEncodedAttribute(VertexFormat format, std::byte* out, size_t stride, const T* stream, size_t count) {
+    assert(isVertexFormatSupported<T>(format) && "Format cannot store this attribute type");
+
+    auto encode = [&]<VertexFormat F>() {
+        if constexpr ((F == VertexFormat::Snorm10_10_10_2 && T::length() < 3) ||
+                      (F == VertexFormat::Octahedral && T::length() != 3)) {
+            return;
+        } else {
+            for (size_t i = 0; i < count; i++) {
+                encodeVertexValue<F>(stream[i], out + i * stride);
+            }
+        }
+    };
+
+    switch (format) {
+    case VertexFormat::Float:
+        interleaveAttribute(out, stride, stream, count);
+        break;
+    case VertexFormat::Half:
+        encode.template operator()<VertexFormat::Half>();
+        break;
+    case VertexFormat::Snorm8:
+        encode.template operator()<VertexFormat::Snorm8>();
+        break;
+    case VertexFormat::Unorm8:
+        encode.template operator()<VertexFormat::Unorm8>();
+        break;
+    case VertexFormat::Snorm16:
+        encode.template operator()<VertexFormat::Snorm16>();
+        break;
+    case VertexFormat::Unorm16:
+        encode.template operator()<VertexFormat::Unorm16>();
+        break;
+    case VertexFormat::Snorm10_10_10_2:
+        encode.template operator()<VertexFormat::Snorm10_10_10_2>();
+        break;
+    case VertexFormat::Octahedral:
+        encode.template operator()<VertexFormat::Octahedral>();
+        break;
+    }
+}
+
+// Inverse of interleaveEncodedAttribute. Only Float gives back the exact values, the other formats lose what their
+// encoding dropped.
+template <typename T>
+void deinterleaveEncodedAttribute(VertexFormat format, const std::byte* in, size_t stride, T* stream, size_t count) {
+    assert(isVertexFormatSupported<T>(format) && "Format cannot store this attribute type");
+
+    auto decode = [&]<VertexFormat F>() {
+        if constexpr ((F == VertexFormat::Snorm10_10_10_2 && T::length() < 3) ||
+                      (F == VertexFormat::Octahedral && T::length() != 3)) {
+            return;
+        } else {
+            for (size_t i = 0; i < count; i++) {
+                stream[i] = decodeVertexValue<F, T>(in + i * stride);
+            }
+        }
+    };
+
+    switch (format) {
+    case VertexFormat::Float:
+        decode.template operator()<VertexFormat::Float>();
+        break;
+    case VertexFormat::Half:
+        decode.template operator()<VertexFormat::Half>();
+        break;
+    case VertexFormat::Snorm8:
+        decode.template operator()<VertexFormat::Snorm8>();
+        break;
+    case VertexFormat::Unorm8:
+        decode.template operator()<VertexFormat::Unorm8>();
+        break;
+    case VertexFormat::Snorm16:
+        decode.template operator()<VertexFormat::Snorm16>();
+        break;
+    case VertexFormat::Unorm16:
+        decode.template operator()<VertexFormat::Unorm16>();
+        break;
+    case VertexFormat::Snorm10_10_10_2:
+        decode.template operator()<VertexFormat::Snorm10_10_10_2>();
+        break;
+    case VertexFormat::Octahedral:
+        decode.template operator()<VertexFormat::Octahedral>();
+        break;
+    }
+}
+
+}; // namespace Engine
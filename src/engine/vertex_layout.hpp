@@ -0,0 +1,121 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <span>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define ENGINE_VERTEX_LAYOUT_SSE
+#endif
+
+namespace Engine {
+
+// Where and how one attribute is stored in an interleaved vertex buffer
+struct VertexAttributeFormat {
+    GLint components;
+    GLenum type;
+    GLboolean normalized;
+    size_t offset;
+};
+
+// GL description of a CPU side attribute type
+template <typename T> struct VertexAttributeTraits;
+
+template <> struct VertexAttributeTraits<float> {
+    static constexpr GLint components = 1;
+    static constexpr GLenum type = GL_FLOAT;
+    static constexpr GLboolean normalized = GL_FALSE;
+};
+
+template <glm::length_t N, glm::qualifier Q> struct VertexAttributeTraits<glm::vec<N, float, Q>> {
+    static constexpr GLint components = N;
+    static constexpr GLenum type = GL_FLOAT;
+    static constexpr GLboolean normalized = GL_FALSE;
+};
+
+template <typename T> constexpr VertexAttributeFormat vertexAttributeFormat(size_t offset) {
+    using Traits = VertexAttributeTraits<T>;
+    return {Traits::components, Traits::type, Traits::normalized, offset};
+}
+
+// Copies one attribute stream into its slot of every vertex. The size of T is known at compile time, so every copy
+// is a fixed size move rather than a loop over components.
+template <typename T> void interleaveAttribute(std::byte* out, size_t stride, const T* stream, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        std::memcpy(out + i * stride, stream + i, sizeof(T));
+    }
+}
+
+// Copies one attribute into a vertex. When Wide, 12 and 16 byte attributes are moved with a single 16 byte SSE load
+// and store. For 12 byte attributes that reads 4 bytes past the value and writes 4 bytes past the slot, which only works
+// when both belong to data that is read or written afterwards (see VertexLayout::interleave).
+template <typename T, bool Wide> inline void copyVertexAttribute(std::byte* out, const T* in) {
+#ifdef ENGINE_VERTEX_LAYOUT_SSE
+    if constexpr (Wide && (sizeof(T) == 12 || sizeof(T) == 16)) {
+        auto value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), value);
+        return;
+    }
+#endif
+    std::memcpy(out, in, sizeof(T));
+}
+
+// Points attributes first_location, first_location + 1, ... of the bound VAO at the bound GL_ARRAY_BUFFER, with the
+// vertices starting base_offset bytes into the buffer
+inline void setVertexAttributes(std::span<const VertexAttributeFormat> formats, size_t stride,
+                                GLuint first_location = 0, size_t base_offset = 0) {
+    for (GLuint i = 0; i < formats.size(); i++) {
+        auto& format = formats[i];
+        glVertexAttribPointer(first_location + i, format.components, format.type, format.normalized,
+                              static_cast<GLsizei>(stride), reinterpret_cast<void*>(base_offset + format.offset));
+        glEnableVertexAttribArray(first_location + i);
+    }
+}
+
+// Vertex layout fixed at compile time, one attribute per type in order. Stride, offsets and GL formats are constants
+// and interleave is unrolled over the attributes.
+template <typename... Attributes> struct VertexLayout {
+    static_assert(sizeof...(Attributes) > 0, "A vertex layout needs at least one attribute");
+
+    static constexpr size_t count = sizeof...(Attributes);
+    static constexpr size_t stride = (sizeof(Attributes) + ...);
+
+    static constexpr std::array<size_t, count> offsets = []() {
+        std::array<size_t, count> sizes{sizeof(Attributes)...};
+        std::array<size_t, count> result{};
+        for (size_t i = 1; i < count; i++) {
+            result[i] = result[i - 1] + sizes[i - 1];
+        }
+        return result;
+    }();
+
+    static constexpr std::array<VertexAttributeFormat, count> formats = []<size_t... Is>(std::index_sequence<Is...>) {
+        return std::array<VertexAttributeFormat, count>{vertexAttributeFormat<Attributes>(offsets[Is])...};
+    }(std::index_sequence_for<Attributes...>{});
+
+    // Interleaves vertex_count vertices from one stream per attribute. Whole vertices are written in order, so the
+    // output is streamed through once and every input stream is read sequentially. All vertices but the last are
+    // copied with wide stores: what a store writes past its slot is overwritten by the next attribute or vertex, and
+    // what a load reads past a value is the stream's next element.
+    static void interleave(std::byte* out, size_t vertex_count, const Attributes*... streams) {
+        auto copy = [&]<bool Wide, size_t... Is>(size_t begin, size_t end, std::index_sequence<Is...>) {
+            for (size_t i = begin; i < end; i++) {
+                auto vertex = out + i * stride;
+                (copyVertexAttribute<Attributes, Wide>(vertex + offsets[Is], streams + i), ...);
+            }
+        };
+
+        auto wide_end = vertex_count > 0 ? vertex_count - 1 : 0;
+        copy.template operator()<true>(0, wide_end, std::index_sequence_for<Attributes...>{});
+        copy.template operator()<false>(wide_end, vertex_count, std::index_sequence_for<Attributes...>{});
+    }
+
+    static void setAttributes(GLuint first_location = 0) { setVertexAttributes(formats, stride, first_location); }
+};
+
+}; // namespace Engine
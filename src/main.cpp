@@ -5,6 +5,10 @@
 #include <imgui_impl_opengl3.h>
 #include <random>
 #include "common.hpp"
+#include "engine/arch.hpp"
+#include "engine/geometry_pool.hpp"
+#include "engine/gpu_resource.hpp"
+#include "engine/loop.hpp"
 #include "engine/mesh.hpp"
 #include "engine/shader.hpp"
 #include "engine/shapes.hpp"
@@ -43,28 +47,34 @@ int main() {
     double fps = 0.f;
     float last_time = glfwGetTime();
 
-    Engine::Mesh cube = Engine::cuboidMesh(5.f);
+    // The crates get their own mesh since they set instances on it, the pedestal only draws and can be shared
+    Engine::ShapeCache shapes;
+    auto pedestal = shapes.cylinder(2.f, 8.5f, 24);
+    Engine::Mesh cube = Engine::cuboidMesh(10.f);
     Engine::Mesh platform = Engine::cuboidMesh(100.f, 3.f, 100.f);
     Engine::Mesh sphere = Engine::sphereMesh(10.f, 50);
 
+    platform.setResidency(Engine::MeshResidency::GPUOnly);
+
     std::uniform_real_distribution<float> uniform(0.f, 1.f);
     auto tex_coords = std::vector<glm::vec2>();
-    std::generate_n(std::back_inserter(tex_coords), 8, [&]() {
-        float x = uniform(rng);
-        float y = uniform(rng);
-        return glm::vec2(x, y);
-    });
-
-    // cube.setAssociatedData<glm::vec2>(1, tex_coords.data(), tex_coords.size());
-    platform.setAssociatedData<glm::vec2>(1, tex_coords.data(), tex_coords.size());
-
-    tex_coords.clear();
     std::generate_n(std::back_inserter(tex_coords), sphere.getVertexCount(), [&]() {
         float x = uniform(rng);
         float y = uniform(rng);
         return glm::vec2(x, y);
     });
     sphere.setAssociatedData<glm::vec2>(1, tex_coords.data(), tex_coords.size());
+    sphere.setFormat(1, Engine::VertexFormat::Unorm16);
+
+    auto sphere_report = sphere.optimize();
+    DBG("sphere ACMR " << sphere_report.cache_before.acmr << " -> " << sphere_report.cache_after.acmr << ", ATVR "
+                       << sphere_report.cache_before.atvr << " -> " << sphere_report.cache_after.atvr);
+
+    auto sphere_meshlets = sphere.buildMeshlets();
+    DBG("sphere meshlets " << sphere_meshlets);
+
+    auto sphere_lods = sphere.generateLods();
+    DBG("sphere LODs " << sphere_lods << ", coarsest " << sphere.getLodTriangleCount(sphere_lods - 1) << " triangles");
 
     Engine::Texture crate_texture("assets/textures/crate-texture.jpg");
     crate_texture.setWrap(Engine::TextureWrap::MirroredRepeat);
@@ -75,6 +85,54 @@ int main() {
     Engine::Shader shader;
     shader.build();
 
+    Engine::Shader instanced_shader{Engine::ShaderVariant::Instanced};
+    instanced_shader.build();
+
+    // Ten stacks of crates in a grid on the platform, all drawn in one call
+    std::vector<Engine::MeshInstance> crates;
+    for (int x = 0; x < 10; x++) {
+        for (int z = 0; z < 10; z++) {
+            for (int y = 0; y < 10; y++) {
+                auto model = glm::translate(glm::identity<glm::mat4>(),
+                                            glm::vec3(-54.f + 12.f * x, 8.f + 10.f * y, -54.f + 12.f * z));
+                crates.push_back({model, glm::vec4(uniform(rng), uniform(rng), uniform(rng), 1.f), 0.f});
+            }
+        }
+    }
+    cube.setInstances(crates.data(), crates.size());
+
+    // Props behind the crates, baked into world space and drawn from one pool in a single call
+    using PropLayout = Engine::VertexLayout<glm::vec3, glm::vec2>;
+    Engine::GeometryPool props{PropLayout::formats, PropLayout::stride};
+    std::vector<Engine::GeometryId> prop_ids;
+    Engine::ShapeData prop_shapes[] = {
+        Engine::generateTorus(4.f, 1.f, 32, 16),
+        Engine::generateCylinder(3.f, 8.f, 24),
+        Engine::generateCapsule(2.f, 4.f, 16, 6),
+        Engine::generateIcosphere(3.f, 2),
+    };
+    for (size_t i = 0; i < std::size(prop_shapes); i++) {
+        auto& shape = prop_shapes[i];
+        for (auto& position : shape.positions) {
+            position += glm::vec3(-45.f + 30.f * i, 8.f, -70.f);
+        }
+        prop_ids.push_back(props.add(shape.positions.size(), shape.indices, shape.positions.data(), shape.uvs.data()));
+    }
+
+    Engine::Node scene;
+    scene.add("sphere", Engine::Node{});
+    scene.add("platform", Engine::Node{});
+    auto sphere_node = scene.find("sphere");
+    auto platform_node = scene.find("platform");
+
+    // The simulation runs at a fixed rate, rendering interpolates the sphere's spin between the last two steps
+    Engine::Loop loop{60.0};
+    Engine::Interpolated<float> sphere_angle;
+    loop.simulate = [&](float step) {
+        sphere_angle.set(sphere_angle.get() + step);
+        scene.update(step);
+    };
+
     auto camera = glm::identity<glm::mat4>();
 
     static float rot_y = 0.f;
@@ -130,9 +188,12 @@ int main() {
     while (!glfwWindowShouldClose(window)) {
 
         double time = glfwGetTime();
-        fps = fps * 0.9 + 0.1 / (time - last_time);
+        float delta_time = time - last_time;
+        fps = fps * 0.9 + 0.1 / delta_time;
         last_time = time;
 
+        float alpha = loop.advance(delta_time);
+
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         imguiBegin();
@@ -141,6 +202,14 @@ int main() {
         glClearColor(bg_color[0], bg_color[1], bg_color[2], bg_color[3]);
 
         ImGui::Text("fps: %.2f", fps);
+        ImGui::Text("mesh upload: %zu bytes", Engine::Mesh::takeUploadedBytes());
+        auto triangles = Engine::Mesh::takeTriangleStats();
+        ImGui::Text("triangles: %zu of %zu", triangles.drawn, triangles.full);
+        auto clusters = Engine::Mesh::takeClusterStats();
+        ImGui::Text("meshlets culled: %zu of %zu", clusters.culled, clusters.tested);
+        auto sphere_memory = sphere.getMemoryReport();
+        ImGui::Text("sphere memory: %zu cpu, %zu gpu bytes", sphere_memory.cpu_bytes, sphere_memory.gpu_bytes);
+        ImGui::Text("pending gl deletions: %zu", Engine::GpuDeletionQueue::instance().getPendingCount());
         ImGui::SliderFloat("HORIZONTAL_SENSITIVITY", &HORIZONTAL_SENSITIVITY, 0.f, 0.001f, "%.5f");
         ImGui::SliderFloat("VERTICAL_SENSITIVITY", &VERTICAL_SENSITIVITY, 0.f, 0.001f, "%.5f");
         ImGui::SliderFloat("camera_exponent", &camera_exponent, 0.1f, 5.f, "%.2f");
@@ -151,22 +220,42 @@ int main() {
 
         auto transform = glm::identity<glm::mat4>();
         transform = glm::translate(transform, glm::vec3(0.f, 20.f, 0.f));
-        transform = glm::rotate(transform, float(glfwGetTime()), glm::vec3(1.0f, 1.0f, 1.0f));
-        shader.setMat4Uniform("transform", projection() * transform);
+        transform = glm::rotate(transform, sphere_angle.get(alpha), glm::vec3(1.0f, 1.0f, 1.0f));
+        sphere_node->setLocalTransform(transform);
+        scene.updateTransforms();
 
         crate_texture.bind();
         // cube.draw();
         // transform = glm::scale(transform, glm::vec3(1.f, 1.f, 1.f) * 8.f);
-        shader.setMat4Uniform("transform", projection() * transform);
+        auto sphere_transform = projection() * sphere_node->getWorldTransform();
+        shader.setMat4Uniform("transform", sphere_transform);
+        sphere.selectLod(sphere_transform, HEIGHT);
+        sphere.cullMeshlets(sphere_transform);
         sphere.draw();
 
-        transform = glm::identity<glm::mat4>();
-        shader.setMat4Uniform("transform", projection() * transform);
+        shader.setMat4Uniform("transform", projection() * platform_node->getWorldTransform());
 
         checkerboard.bind();
         platform.draw();
 
+        // Between the platform's top and the bottom of the sphere
+        auto pedestal_model = glm::translate(glm::identity<glm::mat4>(), glm::vec3(0.f, 5.75f, 0.f));
+        shader.setMat4Uniform("transform", projection() * pedestal_model);
+        pedestal->draw();
+
+        shader.setMat4Uniform("transform", projection());
+        for (auto id : prop_ids) {
+            props.queueDraw(id);
+        }
+        props.flush();
+
+        instanced_shader.use();
+        instanced_shader.setMat4Uniform("transform", projection());
+        crate_texture.bind();
+        cube.drawInstanced();
+
         glfwSwapBuffers(window);
+        Engine::GpuDeletionQueue::instance().endFrame();
 
         glfwPollEvents();
 
@@ -182,6 +271,7 @@ int main() {
         last_frame = glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS;
     }
 
+    Engine::GpuDeletionQueue::instance().flush();
     cleanup();
     return 0;
 }
@@ -0,0 +1,99 @@
+// CommandBuffer: commands are applied once each, in the order they were recorded, whether they come from one thread,
+// from commands being applied, or from several threads recording at the same time before the apply.
+
+#include "engine/commands.hpp"
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::fprintf(stderr, "FAILED: %s\n", what.c_str());
+        failures++;
+    }
+}
+
+int main() {
+    // One thread, with commands recording more commands while they are applied
+    {
+        Engine::CommandBuffer commands;
+        std::vector<int> applied;
+        for (int i = 0; i < 100; i++) {
+            commands.record([&, i] {
+                applied.push_back(i);
+                if (i % 10 == 0) {
+                    commands.record([&, i] { applied.push_back(1000 + i); });
+                }
+            });
+        }
+        check(applied.empty(), "nothing applied while recording");
+        check(commands.apply() == 110, "apply count");
+        std::vector<int> expected;
+        for (int i = 0; i < 100; i++) {
+            expected.push_back(i);
+        }
+        for (int i = 0; i < 100; i += 10) {
+            expected.push_back(1000 + i);
+        }
+        check(applied == expected, "single thread order");
+        check(commands.apply() == 0, "second apply is empty");
+    }
+
+    // Several threads recording at once: every command runs exactly once, each thread's commands in its order
+    constexpr int THREADS = 8, PER_THREAD = 20000;
+    Engine::CommandBuffer commands;
+    std::vector<std::pair<int, int>> applied;
+    for (int round = 0; round < 2; round++) {
+        applied.clear();
+        std::vector<std::jthread> threads;
+        for (int t = 0; t < THREADS; t++) {
+            threads.emplace_back([&, t] {
+                for (int i = 0; i < PER_THREAD; i++) {
+                    commands.record([&applied, t, i] { applied.emplace_back(t, i); });
+                }
+            });
+        }
+        threads.clear();
+
+        check(commands.apply() == size_t{THREADS} * PER_THREAD, "threaded apply count");
+        std::vector<int> next(THREADS, 0);
+        bool in_order = applied.size() == size_t{THREADS} * PER_THREAD;
+        for (auto [t, i] : applied) {
+            in_order = in_order && i == next[t]++;
+        }
+        check(in_order, "each thread's commands once and in order, round " + std::to_string(round));
+    }
+
+    // Commands recorded one after the other on different threads keep that order
+    constexpr int TURNS = 1000;
+    std::atomic<int> turn{0};
+    std::vector<int> turns;
+    auto take_turns = [&](int parity) {
+        for (int i = parity; i < TURNS; i += 2) {
+            while (turn.load(std::memory_order_acquire) != i) {
+                std::this_thread::yield();
+            }
+            commands.record([&turns, i] { turns.push_back(i); });
+            turn.store(i + 1, std::memory_order_release);
+        }
+    };
+    {
+        std::jthread even{take_turns, 0}, odd{take_turns, 1};
+    }
+    commands.apply();
+    bool alternating = turns.size() == TURNS;
+    for (int i = 0; alternating && i < TURNS; i++) {
+        alternating = turns[i] == i;
+    }
+    check(alternating, "order across threads");
+
+    if (failures == 0) {
+        std::printf("commands ok\n");
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,101 @@
+// Generated normals and tangents: a box keeps the normals of its faces, and the vertices a UV sphere repeats along its
+// seam get the same normal and tangent on either side, on one thread or several.
+
+#include "engine/jobs.hpp"
+#include "engine/shapes.hpp"
+#include "gl_stub.hpp"
+#include <cstdio>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::fprintf(stderr, "FAILED: %s\n", what.c_str());
+        failures++;
+    }
+}
+
+constexpr size_t TANGENT_FIELD = 3;
+
+static bool close(glm::vec3 a, glm::vec3 b) { return glm::dot(a, b) > 0.9999f; }
+
+static bool close(glm::vec4 a, glm::vec4 b) { return close(glm::vec3(a), glm::vec3(b)) && a.w == b.w; }
+
+int main() {
+    installGlStub();
+
+    // Every face of the box has its own vertices and keeps its flat normal, the corners are sharper than any crease
+    auto box = Engine::generateCuboid({1.f, 2.f, 3.f});
+    auto face_normals = box.normals;
+    auto box_mesh = Engine::makeMesh(std::move(box));
+    box_mesh.generateNormals(Engine::SHAPE_NORMAL_FIELD);
+    auto& box_normals = box_mesh.getField<glm::vec3>(Engine::SHAPE_NORMAL_FIELD);
+    size_t box_kept = 0;
+    for (size_t i = 0; i < face_normals.size(); i++) {
+        box_kept += close(box_normals[i], face_normals[i]);
+    }
+    check(box_normals.size() == face_normals.size() && box_kept == face_normals.size(), "box face normals");
+
+    // Without position grouping as well
+    box_mesh.generateNormals(Engine::SHAPE_NORMAL_FIELD, Engine::NormalMode::Smooth, 0.f);
+    box_kept = 0;
+    for (size_t i = 0; i < face_normals.size(); i++) {
+        box_kept += close(box_normals[i], face_normals[i]);
+    }
+    check(box_kept == face_normals.size(), "box face normals with a zero crease angle");
+
+    // The sphere's seam vertices share their positions but not their UVs
+    constexpr float RADIUS = 2.f;
+    auto sphere = Engine::generateSphere(RADIUS, 64, 32);
+    auto positions = sphere.positions;
+    auto sphere_mesh = Engine::makeMesh(std::move(sphere));
+    sphere_mesh.generateNormals(Engine::SHAPE_NORMAL_FIELD);
+    sphere_mesh.generateTangents(TANGENT_FIELD, Engine::SHAPE_NORMAL_FIELD, Engine::SHAPE_UV_FIELD);
+    auto normals = sphere_mesh.getField<glm::vec3>(Engine::SHAPE_NORMAL_FIELD);
+    auto tangents = sphere_mesh.getField<glm::vec4>(TANGENT_FIELD);
+
+    size_t radial = 0;
+    for (size_t i = 0; i < positions.size(); i++) {
+        radial += close(normals[i], positions[i] / RADIUS);
+    }
+    check(radial == positions.size(), "sphere normals point away from the center");
+
+    // Tangents are undefined at the poles, where the UVs of a slice meet at one point
+    std::map<std::tuple<float, float, float>, size_t> first_at;
+    size_t seam_pairs = 0, seam_normals = 0, seam_tangents = 0;
+    for (size_t i = 0; i < positions.size(); i++) {
+        auto p = positions[i];
+        auto [it, inserted] = first_at.try_emplace({p.x, p.y, p.z}, i);
+        if (inserted || std::abs(p.y) >= RADIUS * 0.999f) {
+            continue;
+        }
+        seam_pairs++;
+        seam_normals += normals[i] == normals[it->second];
+        seam_tangents += tangents[i] == tangents[it->second];
+    }
+    check(seam_pairs == 31, "seam vertices found");
+    check(seam_normals == seam_pairs, "identical seam normals");
+    check(seam_tangents == seam_pairs, "identical seam tangents");
+
+    // The same results from several threads
+    Engine::JobSystem jobs{4};
+    sphere_mesh.generateNormals(Engine::SHAPE_NORMAL_FIELD, Engine::NormalMode::Smooth,
+                                Engine::DEFAULT_CREASE_ANGLE, &jobs);
+    sphere_mesh.generateTangents(TANGENT_FIELD, Engine::SHAPE_NORMAL_FIELD, Engine::SHAPE_UV_FIELD, &jobs);
+    check(sphere_mesh.getField<glm::vec3>(Engine::SHAPE_NORMAL_FIELD) == normals, "threaded normals");
+    size_t threaded_tangents = 0;
+    auto& threaded = sphere_mesh.getField<glm::vec4>(TANGENT_FIELD);
+    for (size_t i = 0; i < tangents.size(); i++) {
+        threaded_tangents += close(threaded[i], tangents[i]);
+    }
+    check(threaded_tangents == tangents.size(), "threaded tangents");
+
+    if (failures == 0) {
+        std::printf("mesh normals ok\n");
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+// Quadric simplification and LOD selection: every level has fewer triangles than the one before, open borders and UV
+// seams are kept in place, and selectLod does not flip between two levels around a threshold.
+
+#include "engine/mesh_simplify.hpp"
+#include "engine/shapes.hpp"
+#include "gl_stub.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_transform.hpp>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::fprintf(stderr, "FAILED: %s\n", what.c_str());
+        failures++;
+    }
+}
+
+using Edge = std::pair<uint, uint>;
+
+static std::set<Edge> directedEdges(const std::vector<uint>& indices) {
+    std::set<Edge> edges;
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        for (size_t k = 0; k < 3; k++) {
+            edges.insert({indices[i + k], indices[i + (k + 1) % 3]});
+        }
+    }
+    return edges;
+}
+
+int main() {
+    installGlStub();
+
+    // Levels of a sphere and of a flat plane only ever get smaller
+    std::pair<const char*, Engine::Mesh> shapes[] = {{"sphere", Engine::sphereMesh(1.f, 50)},
+                                                     {"plane", Engine::planeMesh(10.f, 10.f, 40, 40)}};
+    for (auto& [name, mesh] : shapes) {
+        auto levels = mesh.generateLods(4, 0.5f, 1.f);
+        check(levels == 5, std::string{"level count of the "} + name);
+        for (size_t lod = 1; lod < levels; lod++) {
+            check(mesh.getLodTriangleCount(lod) < mesh.getLodTriangleCount(lod - 1),
+                  std::string{"triangles falling at level "} + std::to_string(lod) + " of the " + name);
+        }
+    }
+
+    // The outline of a plane survives: every border edge, one without a twin, is still there after simplification
+    auto plane = Engine::generatePlane({10.f, 10.f}, 40, 40);
+    auto plane_edges = directedEdges(plane.indices);
+    auto simplified_plane = Engine::simplifyMesh(plane.indices, plane.positions, plane.indices.size() / 10, 1.f);
+    check(simplified_plane.size() < plane.indices.size() / 4, "plane is simplified");
+    auto kept_edges = directedEdges(simplified_plane);
+    size_t border_edges = 0;
+    for (auto [a, b] : plane_edges) {
+        if (!plane_edges.contains({b, a})) {
+            border_edges++;
+            check(kept_edges.contains({a, b}), "border edge " + std::to_string(a) + "-" + std::to_string(b));
+        }
+    }
+    check(border_edges == 4 * 40, "border edges of the plane");
+
+    // Vertices sharing a position with another one, the UV seam and the poles of a sphere, are never collapsed
+    auto sphere = Engine::generateSphere(1.f, 32, 16);
+    auto simplified_sphere = Engine::simplifyMesh(sphere.indices, sphere.positions, sphere.indices.size() / 4, 1.f);
+    check(simplified_sphere.size() < sphere.indices.size() / 2, "sphere is simplified");
+    std::set<uint> used(simplified_sphere.begin(), simplified_sphere.end());
+    for (uint a = 0; a < sphere.positions.size(); a++) {
+        bool shared = false;
+        for (uint b = 0; b < sphere.positions.size() && !shared; b++) {
+            shared = a != b && sphere.positions[a] == sphere.positions[b];
+        }
+        // Pole vertices of degenerate triangles may drop out, seam vertices off the poles may not
+        if (shared && std::abs(sphere.positions[a].y) < 0.999f) {
+            check(used.contains(a), "seam vertex " + std::to_string(a));
+        }
+    }
+
+    // LOD selection while moving away from a sphere and back
+    auto mesh = Engine::sphereMesh(1.f, 50);
+    mesh.generateLods();
+    mesh.setLodThreshold(1.f, 0.25f);
+    auto projection = glm::perspective(glm::radians(45.f), 1.f, 0.1f, 1000.f);
+    auto select = [&](float distance) {
+        return mesh.selectLod(projection * glm::translate(glm::mat4{1.f}, {0.f, 0.f, -distance}), 1080.f);
+    };
+
+    float switch_out = 0.f;
+    size_t previous = select(1.1f);
+    check(previous == 0, "full detail up close");
+    bool monotonic = true;
+    for (float distance = 1.1f; distance < 2000.f; distance *= 1.01f) {
+        auto lod = select(distance);
+        monotonic = monotonic && lod >= previous;
+        if (lod > 0 && switch_out == 0.f) {
+            switch_out = distance;
+        }
+        previous = lod;
+    }
+    check(monotonic, "levels only get coarser moving away");
+    check(previous == mesh.getLodCount() - 1, "coarsest level far away");
+    check(switch_out > 0.f, "switching to a coarser level at some distance");
+
+    float switch_in = 0.f;
+    for (float distance = 2000.f; distance > 1.1f; distance /= 1.01f) {
+        if (select(distance) == 0) {
+            switch_in = distance;
+            break;
+        }
+    }
+    check(switch_in > 0.f && switch_in < switch_out * 0.9f, "switching back only well inside the switch distance");
+
+    // Jitter around the distance the first switch happened at keeps the level
+    select(switch_out * 2.f);
+    select(switch_out);
+    auto settled = mesh.getLod();
+    bool stable = true;
+    for (int i = 0; i < 20; i++) {
+        stable = stable && select(switch_out * (i % 2 ? 1.01f : 0.99f)) == settled;
+    }
+    check(settled == 1 && stable, "no flipping at the threshold");
+
+    if (failures == 0) {
+        std::printf("mesh simplify ok\n");
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,77 @@
+// Mesh::weld on a UV sphere holding only positions: the seam and pole duplicates merge down to the analytic vertex
+// count, the remapped indices draw the same triangles, and the result is the same on one thread and on several.
+
+#include "engine/shapes.hpp"
+#include "gl_stub.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <string>
+#include <tuple>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::fprintf(stderr, "FAILED: %s\n", what.c_str());
+        failures++;
+    }
+}
+
+using Triangle = std::array<glm::vec3, 3>;
+
+// Triangles as their corner positions, each rotated to start at its smallest corner so that the winding is kept
+static std::vector<Triangle> triangles(const std::vector<uint>& indices, const std::vector<glm::vec3>& positions) {
+    auto less = [](const glm::vec3& a, const glm::vec3& b) {
+        return std::tie(a.x, a.y, a.z) < std::tie(b.x, b.y, b.z);
+    };
+    std::vector<Triangle> result;
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        Triangle triangle{positions[indices[i]], positions[indices[i + 1]], positions[indices[i + 2]]};
+        std::ranges::rotate(triangle, std::ranges::min_element(triangle, less));
+        result.push_back(triangle);
+    }
+    std::ranges::sort(result, [&](const Triangle& a, const Triangle& b) {
+        return std::ranges::lexicographical_compare(a, b, less);
+    });
+    return result;
+}
+
+int main() {
+    installGlStub();
+
+    // Large enough to be split into several jobs
+    constexpr size_t SLICES = 400, STACKS = 200;
+    auto shape = Engine::generateSphere(1.f, SLICES, STACKS);
+    auto expected = triangles(shape.indices, shape.positions);
+
+    auto weld = [&](Engine::JobSystem* jobs) {
+        Engine::Mesh mesh;
+        mesh.setVertexPositions(shape.positions.data(), shape.positions.size());
+        mesh.setElementBuffer(shape.indices.data(), shape.indices.size());
+        auto report = mesh.weld(0.f, jobs);
+        check(report.vertices_before == (SLICES + 1) * (STACKS + 1), "vertex count before welding");
+        return std::pair{mesh.getElementBuffer(), mesh.getField<glm::vec3>(0)};
+    };
+
+    auto [serial_indices, serial_positions] = weld(nullptr);
+    // Every inner ring keeps one vertex per slice, the seam column and the rings at the poles collapse
+    check(serial_positions.size() == SLICES * (STACKS - 1) + 2, "vertex count after welding");
+    check(triangles(serial_indices, serial_positions) == expected, "welded triangles");
+    check(std::ranges::all_of(serial_indices, [&](uint index) { return index < serial_positions.size(); }),
+          "indices within the welded vertices");
+
+    for (size_t threads : {1, 4}) {
+        Engine::JobSystem jobs{threads};
+        auto [indices, positions] = weld(&jobs);
+        auto name = std::to_string(threads) + " thread(s)";
+        check(indices == serial_indices, "indices on " + name);
+        check(positions == serial_positions, "positions on " + name);
+    }
+
+    if (failures == 0) {
+        std::printf("mesh weld ok\n");
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,53 @@
+// RangeAllocator: best fit allocation, coalescing of freed neighbours and reset after compaction.
+
+#include "engine/geometry_pool.hpp"
+#include <cstdio>
+#include <string>
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::fprintf(stderr, "FAILED: %s\n", what.c_str());
+        failures++;
+    }
+}
+
+int main() {
+    Engine::RangeAllocator ranges{100};
+    check(ranges.getFreeSize() == 100 && ranges.getLargestFree() == 100, "one free block to start with");
+
+    // Allocations are handed out front to back from the single block
+    auto a = ranges.allocate(40), b = ranges.allocate(10), c = ranges.allocate(30), d = ranges.allocate(20);
+    check(a == 0 && b == 40 && c == 50 && d == 80, "offsets of consecutive allocations");
+    check(ranges.getFreeSize() == 0 && !ranges.allocate(1), "nothing left once full");
+
+    // Best fit: with free blocks of 40 at 0 and 30 at 50, a request of 25 takes the 30 and leaves 5 of it
+    ranges.free(*a, 40);
+    ranges.free(*c, 30);
+    auto e = ranges.allocate(25);
+    check(e == 50, "a request goes to the smallest block it fits in");
+    check(ranges.getFreeSize() == 45 && ranges.getLargestFree() == 40, "the rest of a split block stays free");
+
+    // Freeing next to a free block merges with it, freeing between two merges all three
+    ranges.free(*e, 25);
+    check(ranges.getLargestFree() == 40 && ranges.getFreeSize() == 70, "freeing before a free block");
+    ranges.free(*d, 20);
+    check(ranges.getLargestFree() == 50, "freeing after a free block");
+    ranges.free(*b, 10);
+    check(ranges.getFreeSize() == 100 && ranges.getLargestFree() == 100, "freeing between two free blocks");
+
+    // After the owner compacted its data into [0, used), everything past it is one block, at the new capacity
+    ranges.allocate(50);
+    ranges.reset(40, 200);
+    check(ranges.getCapacity() == 200, "capacity after reset");
+    check(ranges.getFreeSize() == 160 && ranges.getLargestFree() == 160, "one free block after reset");
+    check(ranges.allocate(160) == 40 && ranges.getFreeSize() == 0, "the free block starts at the used size");
+    ranges.reset(200, 200);
+    check(ranges.getFreeSize() == 0 && !ranges.allocate(1), "reset to a full range");
+
+    if (failures == 0) {
+        std::printf("range allocator ok\n");
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,176 @@
+// Scene file round trip: saves a tree, loads it back into a fresh one and compares the two node by node. Corrupt
+// and truncated files must be rejected when they are opened.
+
+#include "engine/scene_file.hpp"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <glm/gtc/matrix_transform.hpp>
+#include <string>
+
+using Engine::SceneFileComponent;
+using Engine::SceneFileHeader;
+using Engine::SceneFileNode;
+
+struct Position {
+    glm::vec3 value;
+};
+
+struct Health {
+    float value;
+    int lives;
+};
+
+// Not registered as serializable, must not be saved
+struct Scratch {
+    int value;
+};
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::fprintf(stderr, "FAILED: %s\n", what.c_str());
+        failures++;
+    }
+}
+
+static void compare(Engine::Node& saved, Engine::Node& loaded, Engine::World& saved_world, Engine::World& loaded_world,
+                    bool is_root) {
+    auto path = saved.getPath();
+    if (!is_root) {
+        check(saved.getName() == loaded.getName(), "name of " + path);
+        check(saved.getPath() == loaded.getPath(), "path of " + path);
+    }
+    check(saved.getLocalTransform() == loaded.getLocalTransform(), "transform of " + path);
+    check(!saved.getWorld() == !loaded.getWorld(), "entity of " + path);
+
+    if (saved.getWorld() && loaded.getWorld()) {
+        auto a = saved.getEntity(), b = loaded.getEntity();
+        auto position = loaded_world.get<Position>(b);
+        check(!saved_world.get<Position>(a) == !position, "Position of " + path);
+        if (position) {
+            check(saved_world.get<Position>(a)->value == position->value, "Position value of " + path);
+        }
+        auto saved_health = saved_world.get<Health>(a), health = loaded_world.get<Health>(b);
+        check(!saved_health == !health, "Health of " + path);
+        if (health) {
+            check(saved_health->value == health->value && saved_health->lives == health->lives,
+                  "Health value of " + path);
+        }
+        check(!loaded_world.has<Scratch>(b), "unregistered component of " + path);
+    }
+
+    std::vector<Engine::Node*> saved_children, loaded_children;
+    saved.forEachChild([&](Engine::Node& child) { saved_children.push_back(&child); });
+    loaded.forEachChild([&](Engine::Node& child) { loaded_children.push_back(&child); });
+    check(saved_children.size() == loaded_children.size(), "child count of " + path);
+    for (size_t i = 0; i < std::min(saved_children.size(), loaded_children.size()); i++) {
+        compare(*saved_children[i], *loaded_children[i], saved_world, loaded_world, false);
+    }
+}
+
+int main() {
+    Engine::registerSerializable<Position>("Position");
+    Engine::registerSerializable<Health>("Health");
+
+    // Three levels, children added out of name order, every third node owning an entity
+    Engine::World world;
+    Engine::Node root;
+    root.setLocalTransform(glm::scale(glm::mat4{1.f}, glm::vec3{2.f}));
+    int counter = 0;
+    for (auto group_name : {"zeta", "alpha", "mid"}) {
+        auto group = root.emplace<Engine::Node>(group_name);
+        for (int i = 0; i < 5; i++) {
+            auto child = group->emplace<Engine::Node>("item" + std::to_string(4 - i));
+            child->setLocalTransform(glm::translate(glm::mat4{1.f}, glm::vec3{float(i), float(counter), -1.f}));
+            if (counter++ % 3 == 0) {
+                auto entity = world.create();
+                world.add(entity, Position{glm::vec3{float(counter), 0.5f, 0.25f}});
+                if (i % 2 == 0) {
+                    world.add(entity, Health{float(i) * 10.f, i});
+                }
+                world.add(entity, Scratch{i});
+                child->setEntity(world, entity);
+            }
+            if (i == 2) {
+                child->emplace<Engine::Node>("leaf")->setLocalTransform(glm::rotate(glm::mat4{1.f}, 0.5f, {0, 1, 0}));
+            }
+        }
+    }
+    root.update(0.f);
+
+    auto path = (std::filesystem::temp_directory_path() / "test_scene_file.glsc").string();
+    check(Engine::saveScene(root, path), "saveScene");
+
+    Engine::MappedScene scene{path};
+    check(static_cast<bool>(scene), "mapping the saved file");
+    if (scene) {
+        check(scene.size() == 1 + 3 * 7, "node count in the file");
+        check(scene.name(1) == "zeta" && scene.node(1).parent == 0, "first record after the root");
+
+        Engine::World loaded_world;
+        Engine::Node loaded;
+        scene.instantiate(loaded, &loaded_world);
+        loaded.update(0.f);
+        compare(root, loaded, world, loaded_world, true);
+
+        auto leaf = loaded.find("mid/item2/leaf");
+        check(leaf && leaf->getWorldTransform() == root.find("mid/item2/leaf")->getWorldTransform(),
+              "world transform after loading");
+    }
+
+    // Files whose header is fine but whose records point outside their sections are rejected as well
+    std::string saved;
+    {
+        std::ifstream file{path, std::ios::binary};
+        saved.assign(std::istreambuf_iterator<char>{file}, {});
+    }
+    auto corrupt = [&](const std::string& what, auto&& change) {
+        auto bytes = saved;
+        SceneFileHeader header;
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        change(header, reinterpret_cast<SceneFileNode*>(bytes.data() + header.nodes_offset),
+               reinterpret_cast<SceneFileComponent*>(bytes.data() + header.components_offset));
+        {
+            std::ofstream file{path, std::ios::binary | std::ios::trunc};
+            file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        }
+        check(!Engine::MappedScene{path}, "rejecting " + what);
+    };
+    corrupt("a name past the string table", [](auto&, auto nodes, auto) { nodes[1].name_length = 1 << 30; });
+    corrupt("a parent after its child", [](auto&, auto nodes, auto) { nodes[2].parent = 5; });
+    corrupt("a root with a parent", [](auto&, auto nodes, auto) { nodes[0].parent = 0; });
+    corrupt("components past the records", [](auto& header, auto nodes, auto) {
+        nodes[2].first_component = header.component_count;
+        nodes[2].component_count = 1;
+    });
+    corrupt("component data past its section", [](auto& header, auto, auto components) {
+        components[0].data_offset = header.data_size - 4;
+    });
+    corrupt("a truncated string table", [&](auto& header, auto nodes, auto) {
+        nodes[header.node_count - 1].name_offset = static_cast<uint32_t>(header.strings_size);
+    });
+
+    {
+        std::ofstream file{path, std::ios::binary | std::ios::trunc};
+        file.write(saved.data(), static_cast<std::streamsize>(saved.size() / 2));
+    }
+    check(!Engine::MappedScene{path}, "rejecting a truncated file");
+
+    // Files that are not scene files are rejected instead of being read
+    {
+        std::ofstream file{path, std::ios::binary | std::ios::trunc};
+        file << std::string(256, 'x');
+    }
+    check(!Engine::MappedScene{path}, "rejecting a file with a bad header");
+    check(!Engine::MappedScene{path + ".missing"}, "rejecting a missing file");
+    std::filesystem::remove(path);
+
+    if (failures == 0) {
+        std::printf("scene file round trip ok\n");
+    }
+    return failures == 0 ? 0 : 1;
+}